@@ -0,0 +1,13 @@
+\ Benchmark harness shared by the bench_*.fs files.
+\ Each result is printed as one line:   bench: <name> <ms> ms
+
+: bench ( xt a n -- ) rot ms-ticks >r execute ms-ticks r> -
+                      ." bench: " -rot type space n. ."  ms" cr ;
+
+\ Same for a run over a known number of bytes, with the rate appended:
+\   bench: <name> <ms> ms <rate> bytes/s
+: bench-bytes ( xt a n bytes -- ) >r rot ms-ticks >r execute ms-ticks r> -
+                      ." bench: " -rot type space dup n. ."  ms "
+                      r> 1000 rot 1 max */ n. ."  bytes/s" cr ;
+
+\ end.
@@ -0,0 +1,44 @@
+\ Times allocate/free with malloc and with an arena: 100000 requests
+\ of 16..527 bytes over 16 live slots, then 100000 allocate/free pairs.
+\ The span lines give how far apart in memory the churned blocks landed.
+\ The tracked lines repeat the arena runs under heap-track-on.
+
+needs bench.fs
+
+16 constant slots
+create live slots cells allot
+variable seed   variable lo   variable hi
+
+: size ( -- n ) seed @ 1103515245 * 12345 + dup seed ! 16 rshift 511 and 16 + ;
+: note ( a -- a ) dup lo @ min lo !  dup hi @ max hi ! ;
+: churn   1 seed !  live slots cells erase  -1 1 rshift lo !  0 hi !
+   99999 for
+     r@ slots mod cells live + dup @ ?dup if free throw then
+     size allocate throw note swap !
+   next
+   slots 0 do live i cells + @ free throw loop ;
+: pairs   99999 for 64 allocate throw free throw next ;
+: span ( a n -- ) ." span: " type space hi @ lo @ - n. ."  bytes" cr ;
+
+32768 arena-new constant bench-arena
+
+: run-malloc         0 arena! churn ;
+: run-arena          bench-arena arena! churn 0 arena! ;
+: run-malloc-pairs   0 arena! pairs ;
+: run-arena-pairs    bench-arena arena! pairs 0 arena! ;
+: tracked ( xt -- ) heap-track-on execute heap-track-off ;
+: run-arena-tracked   ['] run-arena tracked ;
+: run-pairs-tracked   ['] run-arena-pairs tracked ;
+
+' run-malloc s" malloc" bench   s" malloc" span
+' run-arena s" arena" bench   s" arena" span
+' run-malloc-pairs s" malloc-pairs" bench
+' run-arena-pairs s" arena-pairs" bench
+' run-arena-tracked s" arena-tracked" bench
+' run-pairs-tracked s" arena-pairs-tracked" bench
+
+\ Deleting the arena a task still allocates from puts it back on malloc.
+bench-arena arena!   bench-arena arena-delete   arena@ 0= assert
+64 allocate throw free throw
+
+\ end.
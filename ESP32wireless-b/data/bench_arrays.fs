@@ -0,0 +1,39 @@
+\ Times the arrays kernels against the same loops written in Forth,
+\ over 1000-element buffers. Runs on the host and from SPIFFS.
+\ The native rows make ten times the passes of the Forth rows.
+
+needs bench.fs
+
+arrays
+
+1000 constant len
+len 4 * room   create xs len 4 * allot
+len 4 * room   create ys len 4 * allot
+len sfloats room   create fx len sfloats allot
+len sfloats room   create fy len sfloats allot
+: init   len 0 do i 7 * 100 mod xs i 4 * + l!  i ys i 4 * + l!
+                  i s>f fx i sfloats + sf!  1e fy i sfloats + sf! loop ;
+init
+
+: forth-sum ( -- n ) 0 len 0 do xs i 4 * + sl@ + loop ;
+: forth-dot ( -- n ) 0 len 0 do xs i 4 * + sl@ ys i 4 * + sl@ * + loop ;
+: forth-saxpy   len 0 do fx i sfloats + sf@ 0.5e f*
+                         fy i sfloats + dup sf@ f+ sf! loop ;
+
+: run-forth-sum     999 for forth-sum drop next ;
+: run-native-sum    9999 for xs len i32sum 2drop next ;
+: run-forth-dot     999 for forth-dot drop next ;
+: run-native-dot    9999 for xs ys len i32dot 2drop next ;
+: run-forth-saxpy   999 for forth-saxpy next ;
+: run-native-saxpy  9999 for fx fy len 0.5e f32saxpy next ;
+
+' run-forth-sum s" sum-forth" bench
+' run-native-sum s" sum-native" bench
+' run-forth-dot s" dot-forth" bench
+' run-native-dot s" dot-native" bench
+' run-forth-saxpy s" saxpy-forth" bench
+' run-native-saxpy s" saxpy-native" bench
+
+forth
+
+\ end.
@@ -0,0 +1,31 @@
+\ Times a chain of small factored words, as in data_dumper-a.fs, plain
+\ and with the leaf words marked INLINE. Each chain ends in a call, so
+\ both versions also get the tail call that ; now compiles.
+
+needs bench.fs
+
+: strip ( n -- n ) 127 and ;
+: printable? ( n -- f ) strip 31 > ;
+: step ( n -- n ) dup printable? + ;
+: step2 ( n -- n ) 1+ step ;
+: plain ( n -- n ) step2 ;
+
+: strip' ( n -- n ) 127 and ; inline
+: printable?' ( n -- f ) strip' 31 > ; inline
+: step' ( n -- n ) dup printable?' + ; inline
+: step2' ( n -- n ) 1+ step' ;
+: inlined ( n -- n ) step2' ;
+
+: run-plain   0 1000000 for plain next drop ;
+: run-inlined   0 1000000 for inlined next drop ;
+
+\ A word that exits its caller with r> drop must be called, not tail called.
+: caller-exit   r> drop ;
+: early ( -- n ) 1 caller-exit ;
+: caller ( -- n n ) early 2 ;
+caller 2 = assert 1 = assert
+
+' run-plain s" calls" bench
+' run-inlined s" inline" bench
+
+\ end.
@@ -0,0 +1,44 @@
+\ Times a 16 arm CASE compiled to a DOCASE jump table against the same
+\ CASE left as an OF chain (a constant selector is not a literal), and
+\ a table whose default holds a second table.
+
+needs bench.fs
+
+0 constant bench-zero
+
+: table-case ( n -- n )
+   case
+     0 of 1 endof   1 of 2 endof   2 of 3 endof   3 of 4 endof
+     4 of 5 endof   5 of 6 endof   6 of 7 endof   7 of 8 endof
+     8 of 9 endof   9 of 10 endof  10 of 11 endof 11 of 12 endof
+     12 of 13 endof 13 of 14 endof 14 of 15 endof 15 of 16 endof
+     0 swap
+   endcase ;
+: chain-case ( n -- n )
+   case
+     bench-zero of 1 endof   1 of 2 endof   2 of 3 endof   3 of 4 endof
+     4 of 5 endof   5 of 6 endof   6 of 7 endof   7 of 8 endof
+     8 of 9 endof   9 of 10 endof  10 of 11 endof 11 of 12 endof
+     12 of 13 endof 13 of 14 endof 14 of 15 endof 15 of 16 endof
+     0 swap
+   endcase ;
+
+: nested-case ( n -- n )
+   case
+     0 of 1 endof   1 of 2 endof   2 of 3 endof   3 of 4 endof
+     case
+       8 of 9 endof   9 of 10 endof  10 of 11 endof 11 of 12 endof
+       0 swap
+     endcase 0
+   endcase ;
+10 nested-case 11 = assert   3 nested-case 4 = assert   12 nested-case 0= assert
+
+: run-table   1000000 for r@ 15 and table-case drop next ;
+: run-chain   1000000 for r@ 15 and chain-case drop next ;
+: run-nested   1000000 for r@ 15 and nested-case drop next ;
+
+' run-chain s" chain" bench
+' run-table s" table" bench
+' run-nested s" nested" bench
+
+\ end.
@@ -0,0 +1,17 @@
+\ Times CATCH around a word that returns, CATCH around a THROW, and
+\ EVALUATE of short lines the way quit and included run them.
+
+needs bench.fs
+
+: bench-ok ( n -- n ) 1+ ;
+: bench-throw ( n -- ) throw ;
+
+: catch-ok   0 1000000 for ['] bench-ok catch drop next drop ;
+: catch-throw   1000000 for 7 ['] bench-throw catch 2drop next ;
+: catch-eval   100000 for s" 1 2 + drop" ['] evaluate catch drop next ;
+
+' catch-ok s" catch" bench
+' catch-throw s" throw" bench
+' catch-eval s" evaluate" bench
+
+\ end.
@@ -0,0 +1,15 @@
+\ Times calls through a deferred word, the path every type, key and
+\ emit takes, against a direct call of the same word.
+
+needs bench.fs
+
+: bench-target ( n -- n ) 1+ ;
+defer bench-vector   ' bench-target is bench-vector
+
+: call-direct   0 1000000 for bench-target next drop ;
+: call-deferred   0 1000000 for bench-vector next drop ;
+
+' call-direct s" direct" bench
+' call-deferred s" deferred" bench
+
+\ end.
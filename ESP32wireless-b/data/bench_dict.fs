@@ -0,0 +1,17 @@
+\ Times FIND on a recent word, a builtin and a missing name.
+\ A miss walks every wordlist in the search order.
+
+needs bench.fs
+
+: bench-recent ;
+: bench-find ( a n -- ) 100000 for 2dup find drop next 2drop ;
+
+: find-recent   s" bench-recent" bench-find ;
+: find-builtin   s" dup" bench-find ;
+: find-miss   s" no-such-word" bench-find ;
+
+' find-recent s" find-recent" bench
+' find-builtin s" find-builtin" bench
+' find-miss s" find-miss" bench
+
+\ end.
@@ -0,0 +1,20 @@
+\ Times double-cell timestamp math: summing 1000000 tick deltas into a
+\ double and scaling it, natively and with the carry done in Forth.
+
+needs bench.fs
+
+: u< ( a b -- f ) 2dup xor 0< if nip 0< exit then - 0< ;
+: slow-m+ ( d n -- d ) rot over + dup >r swap u< if 1+ then r> swap ;
+
+2variable total
+
+: run-native   0. total 2!
+   999999 for total 2@ r@ 40503 * m+ total 2! next
+   total 2@ 1000 3 m*/ total 2! ;
+: run-forth    0. total 2!
+   999999 for total 2@ r@ 40503 * slow-m+ total 2! next ;
+
+' run-native s" d-native" bench
+' run-forth s" d-forth" bench
+
+\ end.
@@ -0,0 +1,15 @@
+\ Times float text conversion both ways: literals read by the outer
+\ interpreter, and values formatted by f>str, the text behind f.
+
+needs bench.fs
+
+: run-read
+   20000 for
+     s" 3.14159e fdrop -12345.678e-3 fdrop 6.02214e23 fdrop" evaluate
+   next ;
+: run-write   100000 for r@ s>f 0.37e f* f>str 2drop next ;
+
+' run-read s" fread" bench
+' run-write s" fwrite" bench
+
+\ end.
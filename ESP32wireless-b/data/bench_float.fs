@@ -0,0 +1,13 @@
+\ Times floating point arithmetic and libm calls on the float stack.
+
+needs bench.fs
+
+: fsum ( -- ) 0e 1000000 for r@ s>f f+ next fdrop ;
+: fpoly ( -- ) 1000000 for r@ s>f fdup fdup f* fswap 3e f* f+ 1e f+ fdrop next ;
+: fmath ( -- ) 1000000 for r@ s>f fsqrt fsin fdrop next ;
+
+' fsum s" fsum" bench
+' fpoly s" fpoly" bench
+' fmath s" fmath" bench
+
+\ end.
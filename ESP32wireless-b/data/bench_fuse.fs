@@ -0,0 +1,27 @@
+\ Times the same word compiled with and without superinstruction fusion.
+\ Each op cell costs one NEXT dispatch, so the cell counts give the
+\ dispatches saved per call on the straight-line path.
+
+needs bench.fs
+
+internals
+
+variable bench-cell   3 bench-cell !
+: cells. ( xt a n -- ) ." cells: " type space >params n. cr ;
+
+'fusions @ 0 'fusions !
+: plain ( n -- n ) dup 3 + swap 5 = if 1+ then bench-cell @ + dup over + nip ;
+'fusions !
+: fused ( n -- n ) dup 3 + swap 5 = if 1+ then bench-cell @ + dup over + nip ;
+
+: run-plain   1000000 for r@ plain drop next ;
+: run-fused   1000000 for r@ fused drop next ;
+
+' plain s" plain" cells.
+' fused s" fused" cells.
+' run-plain s" plain" bench
+' run-fused s" fused" bench
+
+forth
+
+\ end.
@@ -0,0 +1,93 @@
+\ Times httpd header parsing over a batch of recorded requests.
+\ Each pass loads a request into the chunk buffer the way read-headers
+\ would, then looks up headers, matches the route and finds a token.
+\ http-match times the string compares on their own.
+
+needs bench.fs
+
+httpd
+also internals also httpd
+
+4 constant reqs#
+512 constant req-size
+reqs# req-size * room   create reqs reqs# req-size * allot
+create req-lens reqs# cells allot   req-lens reqs# cells erase
+variable req#
+create crlf 13 c, nl c,
+
+: req ( n -- a ) req-size * reqs + ;
+: req-len ( -- a ) req# @ cells req-lens + ;
+: +req ( a n -- ) >r req# @ req req-len @ + r@ cmove r> req-len +! ;
+: +line ( a n -- ) +req crlf 2 +req ;
+
+0 req# !
+s" GET / HTTP/1.1" +line
+s" Host: 192.168.4.1" +line
+s" User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:115.0) Gecko/20100101 Firefox/115.0" +line
+s" Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8" +line
+s" Accept-Language: en-US,en;q=0.5" +line
+s" Accept-Encoding: gzip, deflate" +line
+s" Connection: keep-alive" +line
+s" Upgrade-Insecure-Requests: 1" +line
+s" " +line
+1 req# !
+s" POST /input HTTP/1.1" +line
+s" Host: 192.168.4.1" +line
+s" User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:115.0) Gecko/20100101 Firefox/115.0" +line
+s" Accept: */*" +line
+s" Accept-Language: en-US,en;q=0.5" +line
+s" Accept-Encoding: gzip, deflate" +line
+s" Content-Type: text/plain;charset=UTF-8" +line
+s" content-length: 6" +line
+s" Origin: http://192.168.4.1" +line
+s" Connection: keep-alive" +line
+s" Referer: http://192.168.4.1/" +line
+s" " +line
+s" words " +req
+2 req# !
+s" GET /image HTTP/1.0" +line
+s" Host: 192.168.4.1" +line
+s" User-Agent: curl/7.88.1" +line
+s" Accept: */*" +line
+s" " +line
+3 req# !
+s" GET /favicon.ico HTTP/1.1" +line
+s" Host: 192.168.4.1" +line
+s" User-Agent: Mozilla/5.0 (Linux; Android 13; Pixel 7) AppleWebKit/537.36 Chrome/116.0 Mobile Safari/537.36" +line
+s" Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8" +line
+s" Referer: http://192.168.4.1/" +line
+s" Accept-Encoding: gzip, deflate" +line
+s" Accept-Language: en-GB,en-US;q=0.9,en;q=0.8" +line
+s" Connection: keep-alive" +line
+s" " +line
+
+: load ( n -- )
+   dup req chunk rot cells req-lens + @ dup to chunk-filled cmove ;
+: route ( -- n )
+   s" /" path str= if 1 exit then
+   s" /input" path str= if 2 exit then
+   s" /image" path str= if 3 exit then
+   0 ;
+: parse1 ( n -- )
+   load completed? drop
+   method s" POST" str= drop route drop
+   content-length drop
+   s" Host" header 2drop
+   s" CONNECTION" header 2drop
+   s" X-Forwarded-For" header 2drop
+   chunk chunk-filled s" keep-alive" search drop 2drop ;
+
+: run-parse   2500 for reqs# 1- for r@ parse1 next next ;
+: run-match
+   200000 for
+     s" /favicon.ico" s" /favicon.icon" str= drop
+     s" /favicon.ico" s" /favicon.ico" str= drop
+     s" Content-Length" s" content-length" strcase= drop
+   next ;
+
+' run-parse s" http-parse" bench
+' run-match s" http-match" bench
+
+only forth definitions
+
+\ end.
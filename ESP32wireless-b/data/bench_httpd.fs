@@ -0,0 +1,47 @@
+\ Times httpd requests over loopback. One task plays both sides:
+\ connect, send a request, handleClient, respond, then read the reply.
+
+needs bench.fs
+
+httpd
+also sockets also httpd
+
+8123 constant bench-port
+sockaddr bench-addr
+-1 value bench-fd
+create bench-reply 512 allot
+
+: bench-listen
+   bench-port httpd-port ->port!
+   AF_INET SOCK_STREAM 0 socket to sockfd
+   sockfd SOL_SOCKET SO_REUSEADDR 1 >r rp@ 4 setsockopt rdrop throw
+   sockfd non-block throw
+   sockfd httpd-port sizeof(sockaddr_in) bind throw
+   sockfd max-connections listen throw ;
+
+: bench-type ( a n -- ) bench-fd write-file throw ;
+: bench-crlf   13 >r rp@ 1 bench-type rdrop nl >r rp@ 1 bench-type rdrop ;
+
+: bench-connect
+   AF_INET SOCK_STREAM 0 socket to bench-fd
+   bench-fd bench-addr sizeof(sockaddr_in) connect throw
+   s" GET /bench HTTP/1.0" bench-type bench-crlf bench-crlf ;
+: bench-serve
+   handleClient 0= throw
+   s" text/plain" ok-response s" hello" send
+   clientfd close-file drop -1 to clientfd ;
+: bench-drain
+   begin bench-reply 512 bench-fd read-file throw 0= until
+   bench-fd close-file drop ;
+
+: httpd-requests   1000 for bench-connect bench-serve bench-drain next ;
+
+bench-port bench-addr ->port!
+$0100007f bench-addr ->addr!
+bench-listen
+' httpd-requests s" httpd" bench
+sockfd close-file drop
+
+only forth definitions
+
+\ end.
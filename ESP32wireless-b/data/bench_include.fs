@@ -0,0 +1,34 @@
+\ Times INCLUDE of a large generated source file.
+\ Every token goes through find, so this tracks dictionary lookup cost.
+
+needs bench.fs
+
+internals
+
+400 value bench-words
+0 value bench-fh
+: bench-path ( -- a n ) sourcedirname s" bench_big.fs" path-join ;
+
+: bench-put ( a n -- ) bench-fh write-file throw ;
+: bench-n ( n -- ) base @ >r decimal <# #s #> bench-put r> base ! ;
+: bench-def ( n -- )
+   s" : bw" bench-put dup bench-n
+   s"  ( n -- n ) dup 1+ swap drop over over 2drop " bench-put
+   dup bench-n s"  + 2* 2/ cell+ aligned " bench-put
+   dup if s"  bw" bench-put dup 1- bench-n then
+   s"  ; " bench-put bench-n s"  drop" bench-put nl >r rp@ 1 bench-put rdrop ;
+: bench-generate
+   bench-path w/o create-file throw to bench-fh
+   bench-words 0 do i bench-def loop
+   bench-fh close-file throw ;
+
+bench-generate
+: bench-marker ;
+: bench-include   bench-path included ;
+' bench-include s" include" bench
+forget bench-marker
+bench-path delete-file drop
+
+forth
+
+\ end.
@@ -0,0 +1,15 @@
+\ Times VALUE fetch/TO/+TO and { } local fetch/store in tight loops.
+
+needs bench.fs
+
+0 value bench-v
+: values   1000000 for bench-v 1+ to bench-v 2 +to bench-v next ;
+: locals   0 { a } 1000000 for a 1+ to a 2 +to a next a drop ;
+: locals2 ( a b -- ) { a b } 1000000 for a b + to a next ;
+: run-locals2   1 2 locals2 ;
+
+' values s" value" bench
+' locals s" local" bench
+' run-locals2 s" local2" bench
+
+\ end.
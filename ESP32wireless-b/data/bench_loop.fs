@@ -0,0 +1,18 @@
+\ Times counted loops.  DO, LOOP, +LOOP, LEAVE and J used to be colon
+\ definitions juggling the return stack; each is now a single opcode.
+
+needs bench.fs
+
+: run-loop    1000000 0 do loop ;
+: run-i       0 1000000 0 do i + loop drop ;
+: run-+loop   0 3000000 0 do i + 3 +loop drop ;
+: run-nested  0 1000 0 do 1000 0 do j + loop loop drop ;
+: run-leave   1000000 0 do 10 0 do i 5 = if leave then loop loop ;
+
+' run-loop s" loop" bench
+' run-i s" i" bench
+' run-+loop s" +loop" bench
+' run-nested s" nested" bench
+' run-leave s" leave" bench
+
+\ end.
@@ -0,0 +1,37 @@
+\ Times access to a 16K buffer in each kind of memory: the dictionary,
+\ internal RAM, DMA-capable RAM and PSRAM. Each kind fills its buffer,
+\ sums it a cell at a time, and copies it to and from the dictionary,
+\ 1000 passes each. Kinds the board lacks print as unavailable.
+
+needs bench.fs
+
+arrays
+
+16384 constant size
+size room   create near size allot
+1000 constant passes
+size passes * constant traffic
+
+variable buf
+: run-fill   passes 1- for buf @ size r@ fill next ;
+: run-sum    passes 1- for buf @ size 4 / i32sum 2drop next ;
+: run-copy   passes 2/ 1- for buf @ near size cmove near buf @ size cmove next ;
+
+create name 32 allot   variable name#
+: named ( a n a n -- a n ) 2swap name swap dup name# ! cmove
+   name name# @ + swap dup name# +! cmove name name# @ ;
+: rows ( a a n -- ) rot buf !
+   2dup s" -fill" named ['] run-fill -rot traffic bench-bytes
+   2dup s" -sum" named ['] run-sum -rot traffic bench-bytes
+   s" -copy" named ['] run-copy -rot traffic bench-bytes ;
+: try ( a ior a n -- ) rot if ." bench: " type ."  unavailable" cr drop
+   else 2>r dup 2r> rows free throw then ;
+
+near s" dict" rows
+size allocate-iram s" internal" try
+size allocate-dma s" dma" try
+size allocate-psram s" psram" try
+
+only forth definitions
+
+\ end.
@@ -0,0 +1,32 @@
+\ Times parse over a real source file held in memory, split into words
+\ (the blank separator, which also takes tab, CR and LF) and into lines.
+
+needs bench.fs
+
+internals
+
+2000 constant passes
+0 value src   0 value src#
+
+: load-src ( a n -- )
+   r/o open-file throw >r
+   r@ file-size throw to src#  src# allocate throw to src
+   src src# r@ read-file throw drop  r> close-file throw ;
+s" tcpptp.fs" load-src
+
+: over-src ( xt -- ) 'tib @ >r #tib @ >r >in @ >r
+   src 'tib ! src# #tib ! 0 >in ! execute
+   r> >in ! r> #tib ! r> 'tib ! ;
+: split-words   begin >in @ #tib @ < while bl parse 2drop repeat ;
+: split-lines   begin >in @ #tib @ < while nl parse 2drop repeat ;
+
+: run-words   passes 1- for ['] split-words over-src next ;
+: run-lines   passes 1- for ['] split-lines over-src next ;
+
+' run-words s" words" src# passes * bench-bytes
+' run-lines s" lines" src# passes * bench-bytes
+
+src free throw
+forth
+
+\ end.
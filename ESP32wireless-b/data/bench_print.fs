@@ -0,0 +1,21 @@
+\ Times printing 100000 numbers with . u. and <# #s #>. type is
+\ pointed at 2drop meanwhile, so only the formatting is measured.
+
+needs bench.fs
+
+: quietly ( xt -- ) ['] type >body @ >r ['] 2drop is type
+   execute r> is type ;
+
+: dots   99999 for r@ 12345 * . next ;
+: hexes  hex 99999 for r@ 12345 * u. next decimal ;
+: picts  99999 for <# r@ # # [char] : hold #s #> type next ;
+
+: run-dot    ['] dots quietly ;
+: run-hex    ['] hexes quietly ;
+: run-pict   ['] picts quietly ;
+
+' run-dot s" dot" bench
+' run-hex s" hex" bench
+' run-pict s" pictured" bench
+
+\ end.
@@ -0,0 +1,37 @@
+\ Stack-heavy kernels for comparing builds with and without
+\ ENABLE_NOS_CACHE (second stack item kept in a register).
+
+needs bench.fs
+
+: fib ( n -- n ) dup 2 < if exit then dup 1- recurse swap 2 - recurse + ;
+: run-fib   30 fib drop ;
+
+8190 constant sieve-size
+sieve-size room   create flags sieve-size allot
+: sieve ( -- n )
+  flags sieve-size 1 fill  0
+  sieve-size 0 do
+    flags i + c@ if
+      i 2* 3 + dup i +
+      begin dup sieve-size < while 0 over flags + c! over + repeat
+      2drop 1+
+    then
+  loop ;
+: run-sieve   100 0 do sieve drop loop ;
+
+1000 constant sort-size
+sort-size cells room   create sort-data sort-size cells allot
+: sort-fill   sort-size 0 do sort-size i - sort-data i cells + ! loop ;
+: bubble ( -- )
+  sort-size 1 do
+    sort-size i - 0 do
+      sort-data i cells + dup 2@ > if dup 2@ swap rot 2! else drop then
+    loop
+  loop ;
+: run-bubble   sort-fill bubble ;
+
+' run-fib s" fib" bench
+' run-sieve s" sieve" bench
+' run-bubble s" bubble" bench
+
+\ end.
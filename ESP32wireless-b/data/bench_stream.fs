@@ -0,0 +1,22 @@
+\ Times byte throughput through a stream (the buffer behind the web
+\ terminal) by filling and draining it from a single task.
+
+needs bench.fs
+
+streams
+
+1024 stream bench-stream
+create bench-chunk 256 allot
+bench-chunk 256 char x fill
+
+: stream-pump ( -- )
+   1000 for
+     bench-chunk 255 bench-stream >stream
+     bench-chunk 256 bench-stream stream>
+   next ;
+
+' stream-pump s" stream" bench
+
+forth
+
+\ end.
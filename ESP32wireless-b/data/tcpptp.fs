@@ -32,14 +32,6 @@ z" bcdefghi" 			value routername		\ <<<<<<<<<<<<<<< EDIT!!
 z" 123456789abc"     	value password			\ <<<<<<<<<<<<<<< EDIT!!  
 
 
-\ case statement
-: ?dup dup if dup then ; 
-internals 
-: case 0 ; immediate 
-: of ['] over , ['] = , ['] 0branch , here 0 , ['] drop , ; immediate 
-: endof ['] branch , here 0 , swap here swap ! ; immediate 
-: endcase ['] drop , begin ?dup while here swap ! repeat ; immediate 
- \ end of case statement
 
 sockets also WiFi definitions
 
@@ -0,0 +1,93 @@
+// Linux stand-in for the parts of the Arduino core that main.cpp uses
+// when built with -DHOST_BUILD (see ../Makefile, target host).
+// Serial is stdin/stdout; hardware calls are no-ops.
+
+#pragma once
+
+#include <limits.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define IRAM_ATTR
+#define MALLOC_CAP_INTERNAL (1 << 11)
+#define MALLOC_CAP_EXEC (1 << 0)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+
+static inline unsigned long millis() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000 + t.tv_nsec / 1000000;
+}
+static inline unsigned long micros() {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+static inline void yield() {}
+static inline void delay(int ms) { usleep(ms * 1000); }
+
+typedef int esp_log_level_t;
+static inline void esp_log_level_set(const char *, esp_log_level_t) {}
+
+static inline size_t heap_caps_get_free_size(int) { return 4 << 20; }
+static inline size_t heap_caps_get_largest_free_block(int) { return 1 << 20; }
+static inline void *heap_caps_malloc(size_t n, int) { return malloc(n); }
+static inline void heap_caps_free(void *p) { free(p); }
+static inline void *heap_caps_realloc(void *p, size_t n, int) { return realloc(p, n); }
+
+struct EspClass {
+  int getHeapSize() { return 320000; }
+  int getFreeHeap() { return 200000; }
+  int getMaxAllocHeap() { return 100000; }
+  const char *getChipModel() { return "HOST"; }
+  int getChipCores() { return 1; }
+  int getFlashChipSize() { return 4 << 20; }
+  int getCpuFreqMHz() { return 0; }
+  int getSketchSize() { return 0; }
+  void deepSleep(long) {}
+  uint64_t getEfuseMac() { return 0; }
+  void restart() { fflush(stdout); exit(0); }
+};
+static EspClass ESP;
+
+// End of input ends the process, so a piped script needs no trailing bye.
+struct SerialClass {
+  void begin(long) {}
+  void end() {}
+  void flush() { fflush(stdout); }
+  int available() {
+    struct pollfd p = {0, POLLIN, 0};
+    return poll(&p, 1, 0) > 0 ? 1 : 0;
+  }
+  int readBytes(uint8_t *b, int n) {
+    fflush(stdout);
+    int r = read(0, b, n);
+    if (r <= 0) { exit(0); }
+    return r;
+  }
+  int write(const uint8_t *b, int n) { return fwrite(b, 1, n, stdout); }
+  void setDebugOutput(int) {}
+};
+static SerialClass Serial;
+
+static inline void pinMode(int, int) {}
+static inline void digitalWrite(int, int) {}
+static inline int digitalRead(int) { return 0; }
+static inline int analogRead(int) { return 0; }
+static inline long pulseIn(int, int, long) { return 0; }
+
+typedef int note_t;
+static inline double ledcSetup(int, double, int) { return 0; }
+static inline void ledcAttachPin(int, int) {}
+static inline void ledcDetachPin(int) {}
+static inline int ledcRead(int) { return 0; }
+static inline double ledcReadFreq(int) { return 0; }
+static inline void ledcWrite(int, int) {}
+static inline double ledcWriteTone(int, double) { return 0; }
+static inline double ledcWriteNote(int, note_t, int) { return 0; }
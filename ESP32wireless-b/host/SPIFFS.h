@@ -0,0 +1,12 @@
+// Linux stand-in for the SPIFFS object; /spiffs paths are plain files.
+
+#pragma once
+
+struct SPIFFSClass {
+  bool begin(bool, const char *, int) { return true; }
+  void end() {}
+  bool format() { return true; }
+  long totalBytes() { return 0; }
+  long usedBytes() { return 0; }
+};
+static SPIFFSClass SPIFFS;
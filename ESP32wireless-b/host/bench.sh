@@ -0,0 +1,13 @@
+#!/bin/sh
+# Runs every data/bench_*.fs on the host build and prints one CSV row
+# per result:   file,name,ms
+# usage: host/bench.sh [esp32forth-binary]
+
+cd "$(dirname "$0")/../data" || exit 1
+forth=${1:-../host/esp32forth}
+
+echo "file,name,ms"
+for f in bench_*.fs; do
+  echo "include $f" | "$forth" |
+    sed -n "s/^bench: \([^ ]*\) \([0-9-]*\) ms.*/$f,\1,\2/p"
+done
@@ -0,0 +1,9 @@
+// Linux host build of the ESP32forth VM in ../src/main.cpp.
+// Built by the host target in ../Makefile.
+
+#include "../src/main.cpp"
+
+int main() {
+  setup();
+  for (;;) { loop(); }
+}
@@ -27,28 +27,40 @@
 
 // Default on several options.
 #define ENABLE_SPIFFS_SUPPORT
-#define ENABLE_WIFI_SUPPORT
-#define ENABLE_MDNS_SUPPORT
-#define ENABLE_I2C_SUPPORT
 #define ENABLE_SOCKETS_SUPPORT
-#define ENABLE_FREERTOS_SUPPORT
-#define ENABLE_INTERRUPTS_SUPPORT
 #define ENABLE_LEDC_SUPPORT
-#define ENABLE_SD_SUPPORT
-#define ENABLE_SPI_FLASH_SUPPORT
+#define ENABLE_ARRAYS_SUPPORT
+
+// HOST_BUILD is set by the Linux build in ../host (make host); it drops
+// the board-only options and adds the posix words.
+#ifndef HOST_BUILD
+# define ENABLE_WIFI_SUPPORT
+# define ENABLE_MDNS_SUPPORT
+# define ENABLE_I2C_SUPPORT
+# define ENABLE_FREERTOS_SUPPORT
+# define ENABLE_INTERRUPTS_SUPPORT
+# define ENABLE_SD_SUPPORT
+# define ENABLE_SPI_FLASH_SUPPORT
+# define ENABLE_BOOT_IMAGE_SUPPORT
+#else
+# define ENABLE_POSIX_SUPPORT
+#endif
 
 // SD_MMC does not work on ESP32-S2 / ESP32-C3
-#if !defined(CONFIG_IDF_TARGET_ESP32S2) && !defined(CONFIG_IDF_TARGET_ESP32C3)
+#if !defined(CONFIG_IDF_TARGET_ESP32S2) && !defined(CONFIG_IDF_TARGET_ESP32C3) && \
+    !defined(HOST_BUILD)
 # define ENABLE_SD_MMC_SUPPORT
 #endif
 
 // Serial2 does not work on ESP32-S2 / ESP32-C3
-#if !defined(CONFIG_IDF_TARGET_ESP32S2) && !defined(CONFIG_IDF_TARGET_ESP32C3)
+#if !defined(CONFIG_IDF_TARGET_ESP32S2) && !defined(CONFIG_IDF_TARGET_ESP32C3) && \
+    !defined(HOST_BUILD)
 # define ENABLE_SERIAL2_SUPPORT
 #endif
 
 // No DACS on ESP32-S3 and ESP32-C3.
-#if !defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(CONFIG_IDF_TARGET_ESP32C3)
+#if !defined(CONFIG_IDF_TARGET_ESP32S3) && !defined(CONFIG_IDF_TARGET_ESP32C3) && \
+    !defined(HOST_BUILD)
 # define ENABLE_DAC_SUPPORT
 #endif
 
@@ -68,6 +80,31 @@
 //   Adafruit BusIO
 //#define ENABLE_OLED_SUPPORT
 
+// Uncomment this #define to cache the second stack item in a register
+// alongside tos. Compare with data/bench_stack.fs on your board.
+//#define ENABLE_NOS_CACHE
+
+// Uncomment this #define for an instrumented build that counts every
+// word dispatched. See profile-on and .profile.
+//#define ENABLE_PROFILER_SUPPORT
+
+// Uncomment this #define to let a timer sample where the interpreter is.
+// See sample-start and .samples.
+//#define ENABLE_SAMPLER_SUPPORT
+
+// Uncomment this #define to start the dictionary this small, rather than
+// in the largest free block, leaving the rest to WiFi and allocate.
+// The dictionary chains more heap onto itself as it fills.
+//#define DICTIONARY_START_SIZE (48 * 1024)
+
+// Uncomment this #define to run the words built by boot-checkpoint in
+// place from a data partition named "forth" (see partitions_xip.csv),
+// so only what changes is copied into RAM.
+//#define ENABLE_XIP_SUPPORT
+#if defined(ENABLE_XIP_SUPPORT) && !defined(ENABLE_BOOT_IMAGE_SUPPORT)
+# define ENABLE_BOOT_IMAGE_SUPPORT  // for its checkpoint and fixups
+#endif
+
 // For now assume only boards with PSRAM should enable
 // camera support and BluetoothSerial.
 // ESP32-CAM always have PSRAM, but so do WROVER boards,
@@ -92,7 +129,7 @@
   V(forth) V(internals) \
   V(rtos) V(SPIFFS) V(serial) V(SD) V(SD_MMC) V(ESP) \
   V(ledc) V(Wire) V(WiFi) V(bluetooth) V(sockets) V(oled) \
-  V(rmt) V(interrupts) V(spi_flash) V(camera) V(timers) \
+  V(rmt) V(interrupts) V(spi_flash) V(camera) V(timers) V(posix) V(arrays) \
   USER_VOCABULARIES
 #include <inttypes.h>
 #include <stdint.h>
@@ -107,15 +144,35 @@ typedef uintptr_t ucell_t;
 #define X(name, op, code) Z(forth, name, op, code)
 #define Y(op, code) Z(forth, #op, op, code)
 
-#define NIP (--sp)
-#define NIPn(n) (sp -= (n))
-#define DROP (tos = *sp--)
+// NOS is the second stack item and STACK_AT(n) the one n cells below tos
+// (n >= 2). SPILL pushes the cached items so sp addresses a plain memory
+// stack, RELOAD pops them back into registers.
+#ifdef ENABLE_NOS_CACHE
+# define NOS nos
+# define STACK_AT(n) sp[2 - (n)]
+# define NIP (nos = *sp--)
+# define NIPn(n) (sp -= (n), nos = sp[1])
+# define DROP (tos = nos, nos = *sp--)
+# define DUP (*++sp = nos, nos = tos)
+# define SPILL (*++sp = nos, *++sp = tos)
+# define RELOAD (tos = *sp--, nos = *sp--)
+#else
+# define NOS (*sp)
+# define STACK_AT(n) sp[1 - (n)]
+# define NIP (--sp)
+# define NIPn(n) (sp -= (n))
+# define DROP (tos = *sp--)
+# define DUP (*++sp = tos)
+# define SPILL (*++sp = tos)
+# define RELOAD (tos = *sp--)
+#endif
 #define DROPn(n) (NIPn(n-1), DROP)
-#define DUP (*++sp = tos)
 #define PUSH DUP; tos = (cell_t)
 
-#define PARK   DUP; *++rp = (cell_t) fp; *++rp = (cell_t) sp; *++rp = (cell_t) ip
-#define UNPARK ip = (cell_t *) *rp--; sp = (cell_t *) *rp--; fp = (float *) *rp--; DROP
+#define PARK   SPILL; *++rp = (cell_t) fp; *++rp = (cell_t) sp; \
+               *++rp = (cell_t) hp; *++rp = (cell_t) ip
+#define UNPARK ip = (cell_t *) *rp--; hp = (cell_t *) *rp--; \
+               sp = (cell_t *) *rp--; fp = (float *) *rp--; RELOAD
 
 #define TOFLAGS(xt) ((uint8_t *) (((cell_t *) (xt)) - 1))
 #define TONAMELEN(xt) (TOFLAGS(xt) + 1)
@@ -139,14 +196,16 @@ typedef uintptr_t ucell_t;
 #ifndef SSMOD_FUNC
 # if __SIZEOF_POINTER__ == 8
 typedef __int128_t dcell_t;
+typedef __uint128_t udcell_t;
 # elif __SIZEOF_POINTER__ == 4 || defined(_M_IX86)
 typedef int64_t dcell_t;
+typedef uint64_t udcell_t;
 # else
 #  error "unsupported cell size"
 # endif
-# define SSMOD_FUNC dcell_t d = (dcell_t) *sp * (dcell_t) sp[-1]; \
-                    --sp; cell_t a = (cell_t) (d < 0 ? ~(~d / tos) : d / tos); \
-                    *sp = (cell_t) (d - ((dcell_t) a) * tos); tos = a
+# define SSMOD_FUNC dcell_t d = (dcell_t) NOS * (dcell_t) STACK_AT(2); \
+                    NIP; cell_t a = (cell_t) (d < 0 ? ~(~d / tos) : d / tos); \
+                    NOS = (cell_t) (d - ((dcell_t) a) * tos); tos = a
 #endif
 
 typedef struct {
@@ -165,19 +224,19 @@ typedef struct {
   YV(internals, NOP, ) \
   X("0=", ZEQUAL, tos = !tos ? -1 : 0) \
   X("0<", ZLESS, tos = (tos|0) < 0 ? -1 : 0) \
-  X("+", PLUS, tos += *sp--) \
-  X("U/MOD", USMOD, w = *sp; *sp = (ucell_t) w % (ucell_t) tos; \
+  X("+", PLUS, tos += NOS; NIP) \
+  X("U/MOD", USMOD, w = NOS; NOS = (ucell_t) w % (ucell_t) tos; \
                     tos = (ucell_t) w / (ucell_t) tos) \
   X("*/MOD", SSMOD, SSMOD_FUNC) \
-  Y(LSHIFT, tos = (*sp << tos); --sp) \
-  Y(RSHIFT, tos = (((ucell_t) *sp) >> tos); --sp) \
-  Y(ARSHIFT, tos = (*sp >> tos); --sp) \
-  Y(AND, tos &= *sp--) \
-  Y(OR, tos |= *sp--) \
-  Y(XOR, tos ^= *sp--) \
+  Y(LSHIFT, tos = (NOS << tos); NIP) \
+  Y(RSHIFT, tos = (((ucell_t) NOS) >> tos); NIP) \
+  Y(ARSHIFT, tos = (NOS >> tos); NIP) \
+  Y(AND, tos &= NOS; NIP) \
+  Y(OR, tos |= NOS; NIP) \
+  Y(XOR, tos ^= NOS; NIP) \
   X("DUP", ALTDUP, DUP) \
-  Y(SWAP, w = tos; tos = *sp; *sp = w) \
-  Y(OVER, DUP; tos = sp[-1]) \
+  Y(SWAP, w = tos; tos = NOS; NOS = w) \
+  Y(OVER, DUP; tos = STACK_AT(2)) \
   X("DROP", ALTDROP, DROP) \
   X("@", AT, tos = *(cell_t *) tos) \
   X("SL@", SLAT, tos = *(int32_t *) tos) \
@@ -185,12 +244,12 @@ typedef struct {
   X("SW@", SWAT, tos = *(int16_t *) tos) \
   X("UW@", UWAT, tos = *(uint16_t *) tos) \
   X("C@", CAT, tos = *(uint8_t *) tos) \
-  X("!", STORE, *(cell_t *) tos = *sp--; DROP) \
-  X("L!", LSTORE, *(int32_t *) tos = *sp--; DROP) \
-  X("W!", WSTORE, *(int16_t *) tos = *sp--; DROP) \
-  X("C!", CSTORE, *(uint8_t *) tos = *sp--; DROP) \
-  X("SP@", SPAT, DUP; tos = (cell_t) sp) \
-  X("SP!", SPSTORE, sp = (cell_t *) tos; DROP) \
+  X("!", STORE, *(cell_t *) tos = NOS; DROPn(2)) \
+  X("L!", LSTORE, *(int32_t *) tos = NOS; DROPn(2)) \
+  X("W!", WSTORE, *(int16_t *) tos = NOS; DROPn(2)) \
+  X("C!", CSTORE, *(uint8_t *) tos = NOS; DROPn(2)) \
+  X("SP@", SPAT, SPILL; w = (cell_t) sp; RELOAD; PUSH w) \
+  X("SP!", SPSTORE, sp = (cell_t *) tos; RELOAD) \
   X("RP@", RPAT, DUP; tos = (cell_t) rp) \
   X("RP!", RPSTORE, rp = (cell_t *) tos; DROP) \
   X(">R", TOR, *++rp = tos; DROP) \
@@ -205,6 +264,8 @@ typedef struct {
   YV(internals, DOCOL, ++rp; *rp = (cell_t) ip; ip = (cell_t *) (w + sizeof(cell_t))) \
   YV(internals, DOCON, DUP; tos = *(cell_t *) (w + sizeof(cell_t))) \
   YV(internals, DOVAR, DUP; tos = w + sizeof(cell_t)) \
+  YV(internals, DODEFER, w = *(cell_t *) (w + sizeof(cell_t)); \
+                         if (w) JMPW; PUSH -1; goto OP_THROW) \
   YV(internals, DOCREATE, DUP; tos = w + sizeof(cell_t) * 2) \
   YV(internals, DODOES, DUP; tos = w + sizeof(cell_t) * 2; \
                         ++rp; *rp = (cell_t) ip; \
@@ -212,52 +273,55 @@ typedef struct {
   YV(internals, ALITERAL, COMMA(g_sys->DOLIT_XT); COMMA(tos); DROP) \
   Y(CELL, DUP; tos = sizeof(cell_t)) \
   XV(internals, "LONG-SIZE", LONG_SIZE, DUP; tos = sizeof(long)) \
-  Y(FIND, tos = find((const char *) *sp, tos); --sp) \
-  Y(PARSE, DUP; tos = parse(tos, sp)) \
+  Y(FIND, tos = find((const char *) NOS, tos); NIP) \
+  X("COMPILE,", COMPILE, compile(tos); DROP) \
+  Y(PARSE, cell_t a; w = parse(tos, &a); tos = a; PUSH w) \
   XV(internals, "S>NUMBER?", \
-      CONVERT, tos = convert((const char *) *sp, tos, g_sys->base, sp); \
-      if (!tos) --sp) \
-  Y(CREATE, DUP; DUP; tos = parse(32, sp); \
-            create((const char *) *sp, tos, 0, ADDROF(DOCREATE)); \
-            COMMA(0); DROPn(2)) \
-  Y(VARIABLE, DUP; DUP; tos = parse(32, sp); \
-              create((const char *) *sp, tos, 0, ADDROF(DOVAR)); \
-              COMMA(0); DROPn(2)) \
-  Y(CONSTANT, DUP; DUP; tos = parse(32, sp); \
-              create((const char *) *sp, tos, 0, ADDROF(DOCON)); \
-              DROPn(2); COMMA(tos); DROP) \
+      CONVERT, cell_t n; tos = convert((const char *) NOS, tos, g_sys->base, &n); \
+      if (tos) NOS = n; else NIP) \
+  Y(CREATE, cell_t a; w = parse(32, &a); \
+            create((const char *) a, w, 0, ADDROF(DOCREATE)); COMMA(0)) \
+  Y(VARIABLE, cell_t a; w = parse(32, &a); \
+              create((const char *) a, w, 0, ADDROF(DOVAR)); COMMA(0)) \
+  Y(CONSTANT, cell_t a; w = parse(32, &a); \
+              create((const char *) a, w, 0, ADDROF(DOCON)); COMMA(tos); DROP) \
+  Y(DEFER, cell_t a; w = parse(32, &a); \
+           create((const char *) a, w, 0, ADDROF(DODEFER)); COMMA(0)) \
   X("DOES>", DOES, DOES(ip); ip = (cell_t *) *rp; --rp) \
   Y(IMMEDIATE, DOIMMEDIATE()) \
+  Y(INLINE, if (!inline_mark((cell_t) g_sys->latestxt)) { PUSH -1; goto OP_THROW; }) \
   X(">BODY", TOBODY, tos = (cell_t) TOBODY(tos)) \
   XV(internals, "'SYS", SYS, DUP; tos = (cell_t) g_sys) \
   YV(internals, YIELD, PARK; return rp) \
-  X(":", COLON, DUP; DUP; tos = parse(32, sp); \
-                create((const char *) *sp, tos, SMUDGE, ADDROF(DOCOL)); \
-                g_sys->state = -1; --sp; DROP) \
+  XV(internals, "boot-checkpoint", BOOT_CHECKPOINT, \
+      g_boot_checkpoint = -1; PARK; return rp) \
+  X(":", COLON, cell_t a; w = parse(32, &a); \
+                create((const char *) a, w, SMUDGE, ADDROF(DOCOL)); \
+                g_sys->state = -1) \
   YV(internals, EVALUATE1, PARK; rp = evaluate1(rp); UNPARK; w = tos; DROP; if (w) JMPW) \
   Y(EXIT, ip = (cell_t *) *rp--) \
   XV(internals, "'builtins", TBUILTINS, DUP; tos = (cell_t) &g_sys->builtins->code) \
-  XV(forth_immediate, ";", SEMICOLON, COMMA(g_sys->DOEXIT_XT); UNSMUDGE(); g_sys->state = 0)
+  XV(forth_immediate, ";", SEMICOLON, compile_exit(); UNSMUDGE(); g_sys->state = 0)
 #define TIER1_OPCODE_LIST \
   Y(nip, NIP) \
   Y(rdrop, --rp) \
   XV(forth, "*/", STARSLASH, SSMOD_FUNC; NIP) \
-  X("*", STAR, tos *= *sp--) \
-  X("/mod", SLASHMOD, DUP; *sp = 1; SSMOD_FUNC) \
-  X("/", SLASH, DUP; *sp = 1; SSMOD_FUNC; NIP) \
-  Y(mod, DUP; *sp = 1; SSMOD_FUNC; DROP) \
+  X("*", STAR, tos *= NOS; NIP) \
+  X("/mod", SLASHMOD, DUP; NOS = 1; SSMOD_FUNC) \
+  X("/", SLASH, DUP; NOS = 1; SSMOD_FUNC; NIP) \
+  Y(mod, DUP; NOS = 1; SSMOD_FUNC; DROP) \
   Y(invert, tos = ~tos) \
   Y(negate, tos = -tos) \
-  X("-", MINUS, tos = (*sp--) - tos) \
-  Y(rot, w = sp[-1]; sp[-1] = *sp; *sp = tos; tos = w) \
-  X("-rot", MROT, w = tos; tos = *sp; *sp = sp[-1]; sp[-1] = w) \
+  X("-", MINUS, tos = NOS - tos; NIP) \
+  Y(rot, w = STACK_AT(2); STACK_AT(2) = NOS; NOS = tos; tos = w) \
+  X("-rot", MROT, w = tos; tos = NOS; NOS = STACK_AT(2); STACK_AT(2) = w) \
   X("?dup", QDUP, if (tos) DUP) \
-  X("<", LESS, tos = *sp < tos ? -1 : 0; --sp) \
-  X(">", GREATER, tos = *sp > tos ? -1 : 0; --sp) \
-  X("<=", LESSEQ, tos = *sp <= tos ? -1 : 0; --sp) \
-  X(">=", GREATEREQ, tos = *sp >= tos ? -1 : 0; --sp) \
-  X("=", EQUAL, tos = *sp == tos ? -1 : 0; --sp) \
-  X("<>", NOTEQUAL, tos = *sp != tos ? -1 : 0; --sp) \
+  X("<", LESS, tos = NOS < tos ? -1 : 0; NIP) \
+  X(">", GREATER, tos = NOS > tos ? -1 : 0; NIP) \
+  X("<=", LESSEQ, tos = NOS <= tos ? -1 : 0; NIP) \
+  X(">=", GREATEREQ, tos = NOS >= tos ? -1 : 0; NIP) \
+  X("=", EQUAL, tos = NOS == tos ? -1 : 0; NIP) \
+  X("<>", NOTEQUAL, tos = NOS != tos ? -1 : 0; NIP) \
   X("0<>", ZNOTEQUAL, tos = tos ? -1 : 0) \
   Y(bl, DUP; tos = ' ') \
   Y(nl, DUP; tos = '\n') \
@@ -267,27 +331,46 @@ typedef struct {
   X("2/", TWOSLASH, tos = tos >> 1) \
   X("4*", FOURSTAR, tos = tos << 2) \
   X("4/", FOURSLASH, tos = tos >> 2) \
-  X("+!", PLUSSTORE, *((cell_t *) tos) += *sp--; DROP) \
+  X("+!", PLUSSTORE, *((cell_t *) tos) += NOS; DROPn(2)) \
   X("cell+", CELLPLUS, tos += sizeof(cell_t)) \
   Y(cells, tos *= sizeof(cell_t)) \
-  X("cell/", CELLSLASH, DUP; tos = sizeof(cell_t); DUP; *sp = 1; SSMOD_FUNC; NIP) \
+  X("cell/", CELLSLASH, DUP; tos = sizeof(cell_t); DUP; NOS = 1; SSMOD_FUNC; NIP) \
   X("2drop", TWODROP, NIP; DROP) \
-  X("2dup", TWODUP, DUP; tos = sp[-1]; DUP; tos = sp[-1]) \
-  X("2@", TWOAT, DUP; *sp = *(cell_t *) tos; tos = ((cell_t *) tos)[1]) \
-  X("2!", TWOSTORE, *(cell_t *) tos = sp[-1]; \
-      ((cell_t *) tos)[1] = *sp; sp -= 2; DROP) \
-  Y(cmove, memmove((void *) *sp, (void *) sp[-1], tos); sp -= 2; DROP) \
-  X("cmove>", cmove2, memmove((void *) *sp, (void *) sp[-1], tos); sp -= 2; DROP) \
-  Y(fill, memset((void *) sp[-1], tos, *sp); sp -= 2; DROP) \
-  Y(erase, memset((void *) *sp, 0, tos); NIP; DROP) \
-  Y(blank, memset((void *) *sp, ' ', tos); NIP; DROP) \
-  Y(min, tos = tos < *sp ? tos : *sp; NIP) \
-  Y(max, tos = tos > *sp ? tos : *sp; NIP) \
+  X("2dup", TWODUP, DUP; tos = STACK_AT(2); DUP; tos = STACK_AT(2)) \
+  X("2@", TWOAT, DUP; NOS = *(cell_t *) tos; tos = ((cell_t *) tos)[1]) \
+  X("2!", TWOSTORE, *(cell_t *) tos = STACK_AT(2); \
+      ((cell_t *) tos)[1] = NOS; DROPn(3)) \
+  Y(cmove, memmove((void *) NOS, (void *) STACK_AT(2), tos); DROPn(3)) \
+  X("cmove>", cmove2, memmove((void *) NOS, (void *) STACK_AT(2), tos); DROPn(3)) \
+  Y(fill, memset((void *) STACK_AT(2), tos, NOS); DROPn(3)) \
+  Y(erase, memset((void *) NOS, 0, tos); NIP; DROP) \
+  Y(blank, memset((void *) NOS, ' ', tos); NIP; DROP) \
+  XV(internals, "mem=", MEMEQUAL, \
+      tos = memcmp((void *) STACK_AT(2), (void *) NOS, tos) ? 0 : -1; NIPn(2)) \
+  X("str=", STREQUAL, tos = tos == STACK_AT(2) && \
+      !memcmp((void *) STACK_AT(3), (void *) NOS, tos) ? -1 : 0; NIPn(3)) \
+  X("startswith?", STARTSWITH, tos = tos <= STACK_AT(2) && \
+      !memcmp((void *) STACK_AT(3), (void *) NOS, tos) ? -1 : 0; NIPn(3)) \
+  XV(internals, "strcase=", STRCASEEQUAL, tos = tos == STACK_AT(2) && \
+      same((const char *) STACK_AT(3), (const char *) NOS, tos) ? -1 : 0; NIPn(3)) \
+  Y(compare, tos = mem_compare((const char *) STACK_AT(3), STACK_AT(2), \
+                               (const char *) NOS, tos); NIPn(3)) \
+  Y(search, w = mem_search((const char *) STACK_AT(3), STACK_AT(2), \
+                           (const char *) NOS, tos); \
+            if (w >= 0) { STACK_AT(3) += w; STACK_AT(2) -= w; } \
+            tos = w >= 0 ? -1 : 0; NIP) \
+  Y(hold, *--g_sys->hld = tos; DROP) \
+  X("#", HASH, tos = hold_digit(tos)) \
+  X("#s", HASHS, do { tos = hold_digit(tos); } while (tos)) \
+  Y(sign, if (tos < 0) { *--g_sys->hld = '-'; } DROP) \
+  Y(min, tos = tos < NOS ? tos : NOS; NIP) \
+  Y(max, tos = tos > NOS ? tos : NOS; NIP) \
   Y(abs, tos = tos < 0 ? -tos : tos) \
   Y(here, DUP; tos = (cell_t) g_sys->heap) \
-  Y(allot, g_sys->heap = (cell_t *) (tos + (cell_t) g_sys->heap); DROP) \
-  X(",", COMMA, COMMA(tos); DROP) \
-  X("c,", CCOMMA, CCOMMA(tos); DROP) \
+  Y(allot, if (!dict_allot(tos)) { PUSH -8; goto OP_THROW; } DROP) \
+  X(",", COMMA, DICT_ROOM(sizeof(cell_t)); COMMA(tos); DROP) \
+  X("c,", CCOMMA, DICT_ROOM(1); CCOMMA(tos); DROP) \
+  X("room", ROOM, dict_reserve(tos); DROP) \
   XV(internals, "'heap", THEAP, DUP; tos = (cell_t) &g_sys->heap) \
   Y(current, DUP; tos = (cell_t) &g_sys->current) \
   XV(internals, "'context", TCONTEXT, DUP; tos = (cell_t) &g_sys->context) \
@@ -295,6 +378,11 @@ typedef struct {
   XV(internals, "'notfound", TNOTFOUND, DUP; tos = (cell_t) &g_sys->notfound) \
   XV(internals, "'heap-start", THEAP_START, DUP; tos = (cell_t) &g_sys->heap_start) \
   XV(internals, "'heap-size", THEAP_SIZE, DUP; tos = (cell_t) &g_sys->heap_size) \
+  XV(internals, "'heap-limit", THEAP_LIMIT, DUP; tos = (cell_t) &g_sys->heap_limit) \
+  XV(internals, "docol", DOCOL_CODE, PUSH g_sys->DOCOL_OP) \
+  XV(internals, "dict-span", DICT_SPAN, tos = dict_span((cell_t *) tos)) \
+  X("segments", SEGMENTS, DUP; tos = 0; \
+      for (DICT_SEGMENT *s = g_sys->segment; s; s = s->prev) { ++tos; }) \
   XV(internals, "'stack-cells", TSTACK_CELLS, DUP; tos = (cell_t) &g_sys->stack_cells) \
   XV(internals, "'boot", TBOOT, DUP; tos = (cell_t) &g_sys->boot) \
   XV(internals, "'boot-size", TBOOT_SIZE, DUP; tos = (cell_t) &g_sys->boot_size) \
@@ -303,14 +391,52 @@ typedef struct {
   X(">in", TIN, DUP; tos = (cell_t) &g_sys->tin) \
   Y(state, DUP; tos = (cell_t) &g_sys->state) \
   Y(base, DUP; tos = (cell_t) &g_sys->base) \
+  Y(hld, DUP; tos = (cell_t) &g_sys->hld) \
   XV(internals, "'argc", ARGC, DUP; tos = (cell_t) &g_sys->argc) \
   XV(internals, "'argv", ARGV, DUP; tos = (cell_t) &g_sys->argv) \
   XV(internals, "'runner", RUNNER, DUP; tos = (cell_t) &g_sys->runner) \
+  XV(internals, "'fusions", TFUSIONS, DUP; tos = (cell_t) &g_sys->fusions) \
+  XV(internals, "'inlines", TINLINES, DUP; tos = (cell_t) &g_sys->inlines) \
   Y(context, DUP; tos = (cell_t) (g_sys->context + 1)) \
   Y(latestxt, DUP; tos = (cell_t) g_sys->latestxt) \
   XV(forth_immediate, "[", LBRACKET, g_sys->state = 0) \
   XV(forth_immediate, "]", RBRACKET, g_sys->state = -1) \
-  YV(forth_immediate, literal, COMMA(g_sys->DOLIT_XT); COMMA(tos); DROP)
+  YV(forth_immediate, literal, COMMA(g_sys->DOLIT_XT); COMMA(tos); DROP) \
+  XV(internals, "LIT+", LITPLUS, tos += *ip++) \
+  XV(internals, "LIT=", LITEQUAL, tos = tos == *ip++ ? -1 : 0) \
+  XV(internals, "@+", ATPLUS, tos = *(cell_t *) tos + NOS; NIP) \
+  XV(internals, "OVER+", OVERPLUS, tos += NOS) \
+  XV(internals, "R>R>", FROMR2, DUP; tos = *rp--; DUP; tos = *rp--) \
+  YV(internals, DODO, rp[1] = NOS; rp[2] = tos; rp += 2; DROPn(2)) \
+  XV(internals, "DO?DO", DOQDO, if (NOS == tos) ip = (cell_t *) *ip; \
+      else (rp[1] = NOS, rp[2] = tos, rp += 2, ++ip); DROPn(2)) \
+  YV(internals, DOLOOP, if (++*rp < rp[-1]) ip = (cell_t *) *ip; else (rp -= 2, ++ip)) \
+  XV(internals, "DO+LOOP", DOPLOOP, w = *rp + tos; \
+      if ((tos < 0) ^ (w < rp[-1])) (*rp = w, ip = (cell_t *) *ip); \
+      else (rp -= 2, ++ip); DROP) \
+  YV(internals, DOLEAVE, rp -= 2; ip = (cell_t *) *ip) \
+  Y(UNLOOP, rp -= 2) \
+  Y(J, DUP; tos = rp[-2]) \
+  Y(K, DUP; tos = rp[-4]) \
+  XV(internals, "=0BRANCH", EQUAL0BRANCH, \
+      if (NOS != tos) ip = (cell_t *) *ip; else ++ip; DROPn(2)) \
+  XV(internals, "LIT=0BRANCH", LITEQUAL0BRANCH, \
+      if (tos != *ip) ip = (cell_t *) ip[1]; else ip += 2; DROP) \
+  Y(CATCH, w = tos; DROP; *++rp = (cell_t) ip; *++rp = (cell_t) fp; \
+           SPILL; *++rp = (cell_t) sp; RELOAD; *++rp = (cell_t) hp; \
+           hp = rp; ip = g_sys->catch_ip; JMPW) \
+  YV(internals, UNCATCH, hp = (cell_t *) *rp; rp -= 3; ip = (cell_t *) *rp--; PUSH 0) \
+  Y(THROW, if (tos) { w = tos; rp = hp; hp = (cell_t *) *rp--; sp = (cell_t *) *rp--; \
+                      fp = (float *) *rp--; ip = (cell_t *) *rp--; RELOAD; PUSH w; } \
+           else { DROP; }) \
+  YV(internals, TAIL, PROFILE_TAIL; ip = (cell_t *) (*ip + sizeof(cell_t))) \
+  YV(internals, DOCASE, if (*ip) { cell_t *t = (cell_t *) *ip; w = tos - t[0]; \
+      if ((ucell_t) w < (ucell_t) t[1] && t[3 + w]) (DROP, ip = (cell_t *) t[3 + w]); \
+      else ip = (cell_t *) t[2]; } else ++ip) \
+  XV(internals, "DO+SET", DOPLUSSET, *((cell_t *) *ip) += tos; ++ip; DROP) \
+  XV(internals, "DOLOCAL@", DOLOCALAT, DUP; tos = *(cell_t *) ((cell_t) rp + *ip++)) \
+  XV(internals, "DOLOCAL!", DOLOCALSTORE, *(cell_t *) ((cell_t) rp + *ip++) = tos; DROP) \
+  XV(internals, "DOLOCAL+!", DOLOCALPLUSSTORE, *(cell_t *) ((cell_t) rp + *ip++) += tos; DROP)
 #define TIER2_OPCODE_LIST \
   X(">flags", TOFLAGS, tos = *TOFLAGS(tos)) \
   X(">flags&", TOFLAGSAT, tos = (cell_t) TOFLAGS(tos)) \
@@ -318,12 +444,15 @@ typedef struct {
   X(">size", TOSIZE, tos = TOSIZE(tos)) \
   X(">link&", TOLINKAT, tos = (cell_t) TOLINK(tos)) \
   X(">link", TOLINK, tos = *TOLINK(tos)) \
-  X(">name", TONAME, DUP; *sp = (cell_t) TONAME(tos); tos = *TONAMELEN(tos)) \
+  X(">name", TONAME, DUP; NOS = (cell_t) TONAME(tos); tos = *TONAMELEN(tos)) \
   Y(aligned, tos = CELL_ALIGNED(tos)) \
   Y(align, g_sys->heap = (cell_t *) CELL_ALIGNED(g_sys->heap)) \
   YV(internals, fill32, cell_t c = tos; DROP; cell_t n = tos; DROP; \
                         uint32_t *a = (uint32_t *) tos; DROP; \
-                        for (;n;--n) *a++ = c)
+                        for (;n;--n) *a++ = c) \
+  XV(internals, "dict-link", DICT_LINK, dict_link(tos); DROP) \
+  XV(internals, "dict-unlink", DICT_UNLINK, dict_unlink(tos); DROP) \
+  XV(internals, "dict-reset", DICT_RESET, dict_reset())
 #include <math.h>
 
 #define FLOATING_POINT_LIST \
@@ -354,7 +483,9 @@ typedef struct {
   X("1/F", FINVERSE, *fp = 1.0f / *fp) \
   X("S>F", STOF, *++fp = (float) tos; DROP) \
   X("F>S", FTOS, DUP; tos = (cell_t) *fp--) \
-  XV(internals, "S>FLOAT?", FCONVERT, tos = fconvert((const char *) *sp, tos, fp)|0; --sp) \
+  XV(internals, "S>FLOAT?", FCONVERT, tos = fconvert((const char *) NOS, tos, fp)|0; NIP) \
+  XV(internals, "FFORMAT", FFORMAT, \
+      tos = fformat(*fp--, NOS, (char *) tos); NIP) \
   Y(SFLOAT, DUP; tos = sizeof(float)) \
   Y(SFLOATS, tos *= sizeof(float)) \
   X("SFLOAT+", SFLOATPLUS, tos += sizeof(float)) \
@@ -371,6 +502,54 @@ typedef struct {
   Y(FMIN, fp[-1] = fmin(+fp[-1], +*fp); --fp) \
   Y(FMAX, fp[-1] = fmax(+fp[-1], +*fp); --fp) \
   Y(FSQRT, *fp = sqrt(+*fp))
+
+// Double-cell numbers sit on the stack as lo hi, hi on top.
+#define DCELL_BITS (sizeof(cell_t) * 8)
+#define DCELL(lo, hi) ((dcell_t) (((udcell_t) (ucell_t) (hi) << DCELL_BITS) | \
+                                  (ucell_t) (lo)))
+#define DTOP DCELL(NOS, tos)
+#define DSECOND DCELL(STACK_AT(3), STACK_AT(2))
+#define DSET(d) (NOS = (cell_t) (d), tos = (cell_t) ((d) >> DCELL_BITS))
+
+#define DOUBLE_CELL_LIST \
+  X("S>D", STOD, DUP; tos = NOS < 0 ? -1 : 0) \
+  X("D>S", DTOS, DROP) \
+  X("D+", DPLUS, dcell_t d = DSECOND + DTOP; DROPn(2); DSET(d)) \
+  X("D-", DMINUS, dcell_t d = DSECOND - DTOP; DROPn(2); DSET(d)) \
+  X("M+", MPLUS, dcell_t d = DCELL(STACK_AT(2), NOS) + tos; DROP; DSET(d)) \
+  Y(DNEGATE, dcell_t d = -DTOP; DSET(d)) \
+  Y(DABS, dcell_t d = DTOP; d = d < 0 ? -d : d; DSET(d)) \
+  X("D2*", DTWOSTAR, udcell_t d = (udcell_t) DTOP << 1; DSET(d)) \
+  X("D2/", DTWOSLASH, dcell_t d = DTOP >> 1; DSET(d)) \
+  X("D0=", DZEQUAL, tos = (tos | NOS) ? 0 : -1; NIP) \
+  X("D0<", DZLESS, tos = tos < 0 ? -1 : 0; NIP) \
+  X("D=", DEQUAL, tos = DSECOND == DTOP ? -1 : 0; NIPn(3)) \
+  X("D<", DLESS, tos = DSECOND < DTOP ? -1 : 0; NIPn(3)) \
+  X("DU<", DULESS, tos = (udcell_t) DSECOND < (udcell_t) DTOP ? -1 : 0; NIPn(3)) \
+  Y(DMAX, dcell_t d = DTOP; dcell_t e = DSECOND; DROPn(2); DSET(d > e ? d : e)) \
+  Y(DMIN, dcell_t d = DTOP; dcell_t e = DSECOND; DROPn(2); DSET(d < e ? d : e)) \
+  X("M*", MSTAR, dcell_t d = (dcell_t) NOS * tos; DSET(d)) \
+  X("UM*", UMSTAR, udcell_t d = (udcell_t) (ucell_t) NOS * (ucell_t) tos; DSET(d)) \
+  X("UM/MOD", UMSMOD, udcell_t d = (udcell_t) DCELL(STACK_AT(2), NOS); \
+                      ucell_t u = tos; NIP; NOS = (cell_t) (d % u); \
+                      tos = (cell_t) (d / u)) \
+  X("SM/REM", SMSREM, dcell_t d = DCELL(STACK_AT(2), NOS); NIP; \
+                      NOS = (cell_t) (d % tos); tos = (cell_t) (d / tos)) \
+  X("FM/MOD", FMSMOD, dcell_t d = DCELL(STACK_AT(2), NOS); NIP; \
+                      dcell_t q = d / tos; dcell_t r = d % tos; \
+                      if (r && (r < 0) != (tos < 0)) { --q; r += tos; } \
+                      NOS = (cell_t) r; tos = (cell_t) q) \
+  X("M*/", MSTARSLASH, dcell_t d = mstarslash(DCELL(STACK_AT(3), STACK_AT(2)), \
+                                             NOS, tos); DROPn(2); DSET(d)) \
+  X("2SWAP", TWOSWAP, w = tos; tos = STACK_AT(2); STACK_AT(2) = w; \
+                      w = NOS; NOS = STACK_AT(3); STACK_AT(3) = w) \
+  X("2OVER", TWOOVER, DUP; DUP; NOS = STACK_AT(5); tos = STACK_AT(4)) \
+  X("2>R", TWOTOR, rp += 2; rp[-1] = NOS; *rp = tos; DROPn(2)) \
+  X("2R>", TWOFROMR, DUP; DUP; NOS = rp[-1]; tos = *rp; rp -= 2) \
+  X("2R@", TWORAT, DUP; DUP; NOS = rp[-1]; tos = *rp) \
+  XV(internals, "D#", DHASH, udcell_t d = hold_ddigit(DTOP); DSET(d)) \
+  XV(internals, "D#S", DHASHS, udcell_t d = DTOP; \
+                               do { d = hold_ddigit(d); } while (d); DSET(d))
 #ifndef CALLTYPE
 # define CALLTYPE
 #endif
@@ -384,46 +563,46 @@ typedef cell_t (CALLTYPE *call_t)();
 #define ct0 ((call_t) n0)
 
 #define CALLING_OPCODE_LIST \
-  YV(internals, CALLCODE, float *t_fp = fp; DUP; \
+  YV(internals, CALLCODE, float *t_fp = fp; SPILL; \
       sp = (cell_t *) (*(call_t*) (w + sizeof(cell_t)))(sp, &t_fp); \
-      fp = t_fp; DROP) \
+      fp = t_fp; RELOAD) \
   YV(internals, CALL0, n0 = ct0()) \
-  YV(internals, CALL1, n0 = ct0(n1); --sp) \
-  YV(internals, CALL2, n0 = ct0(n2, n1); sp -= 2) \
-  YV(internals, CALL3, n0 = ct0(n3, n2, n1); sp -= 3) \
-  YV(internals, CALL4, n0 = ct0(n4, n3, n2, n1); sp -= 4) \
-  YV(internals, CALL5, n0 = ct0(n5, n4, n3, n2, n1); sp -= 5) \
-  YV(internals, CALL6, n0 = ct0(n6, n5, n4, n3, n2, n1); sp -= 6) \
-  YV(internals, CALL7, n0 = ct0(n7, n6, n5, n4, n3, n2, n1); sp -= 7) \
-  YV(internals, CALL8, n0 = ct0(n8, n7, n6, n5, n4, n3, n2, n1); sp -= 8) \
-  YV(internals, CALL9, n0 = ct0(n9, n8, n7, n6, n5, n4, n3, n2, n1); sp -= 9) \
-  YV(internals, CALL10, n0 = ct0(n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); sp -= 10) \
-  YV(internals, CALL11, n0 = ct0(n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); sp -= 11) \
-  YV(internals, CALL12, n0 = ct0(n12, n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); sp -= 12) \
-  YV(internals, CALL13, n0 = ct0(n13, n12, n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); sp -= 13) \
-  YV(internals, CALL14, n0 = ct0(n14, n13, n12, n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); sp -= 14) \
-  YV(internals, CALL15, n0 = ct0(n15, n14, n13, n12, n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); sp -= 15)
+  YV(internals, CALL1, n0 = ct0(n1); NIP) \
+  YV(internals, CALL2, n0 = ct0(n2, n1); NIPn(2)) \
+  YV(internals, CALL3, n0 = ct0(n3, n2, n1); NIPn(3)) \
+  YV(internals, CALL4, n0 = ct0(n4, n3, n2, n1); NIPn(4)) \
+  YV(internals, CALL5, n0 = ct0(n5, n4, n3, n2, n1); NIPn(5)) \
+  YV(internals, CALL6, n0 = ct0(n6, n5, n4, n3, n2, n1); NIPn(6)) \
+  YV(internals, CALL7, n0 = ct0(n7, n6, n5, n4, n3, n2, n1); NIPn(7)) \
+  YV(internals, CALL8, n0 = ct0(n8, n7, n6, n5, n4, n3, n2, n1); NIPn(8)) \
+  YV(internals, CALL9, n0 = ct0(n9, n8, n7, n6, n5, n4, n3, n2, n1); NIPn(9)) \
+  YV(internals, CALL10, n0 = ct0(n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); NIPn(10)) \
+  YV(internals, CALL11, n0 = ct0(n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); NIPn(11)) \
+  YV(internals, CALL12, n0 = ct0(n12, n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); NIPn(12)) \
+  YV(internals, CALL13, n0 = ct0(n13, n12, n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); NIPn(13)) \
+  YV(internals, CALL14, n0 = ct0(n14, n13, n12, n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); NIPn(14)) \
+  YV(internals, CALL15, n0 = ct0(n15, n14, n13, n12, n11, n10, n9, n8, n7, n6, n5, n4, n3, n2, n1); NIPn(15))
 #define SET tos = (cell_t)
 
 #define n0 tos
-#define n1 (*sp)
-#define n2 sp[-1]
-#define n3 sp[-2]
-#define n4 sp[-3]
-#define n5 sp[-4]
-#define n6 sp[-5]
-#define n7 sp[-6]
-#define n8 sp[-7]
-#define n9 sp[-8]
-#define n10 sp[-9]
-#define n11 sp[-10]
-#define n12 sp[-11]
-#define n13 sp[-12]
-#define n14 sp[-13]
-#define n15 sp[-14]
+#define n1 NOS
+#define n2 STACK_AT(2)
+#define n3 STACK_AT(3)
+#define n4 STACK_AT(4)
+#define n5 STACK_AT(5)
+#define n6 STACK_AT(6)
+#define n7 STACK_AT(7)
+#define n8 STACK_AT(8)
+#define n9 STACK_AT(9)
+#define n10 STACK_AT(10)
+#define n11 STACK_AT(11)
+#define n12 STACK_AT(12)
+#define n13 STACK_AT(13)
+#define n14 STACK_AT(14)
+#define n15 STACK_AT(15)
 
 #define a0 ((void *) tos)
-#define a1 (*(void **) &n1)
+#define a1 ((void *) n1)  // n1 may be the nos register, with no address
 #define a2 (*(void **) &n2)
 #define a3 (*(void **) &n3)
 #define a4 (*(void **) &n4)
@@ -431,7 +610,7 @@ typedef cell_t (CALLTYPE *call_t)();
 #define a6 (*(void **) &n6)
 
 #define b0 ((uint8_t *) tos)
-#define b1 (*(uint8_t **) &n1)
+#define b1 ((uint8_t *) n1)
 #define b2 (*(uint8_t **) &n2)
 #define b3 (*(uint8_t **) &n3)
 #define b4 (*(uint8_t **) &n4)
@@ -439,7 +618,7 @@ typedef cell_t (CALLTYPE *call_t)();
 #define b6 (*(uint8_t **) &n6)
 
 #define c0 ((char *) tos)
-#define c1 (*(char **) &n1)
+#define c1 ((char *) n1)
 #define c2 (*(char **) &n2)
 #define c3 (*(char **) &n3)
 #define c4 (*(char **) &n4)
@@ -486,22 +665,291 @@ static cell_t ResizeFile(cell_t fd, cell_t size);
   OPTIONAL_SERIAL_BLUETOOTH_SUPPORT \
   OPTIONAL_CAMERA_SUPPORT \
   OPTIONAL_SOCKETS_SUPPORT \
+  OPTIONAL_POSIX_SUPPORT \
+  OPTIONAL_ARRAYS_SUPPORT \
   OPTIONAL_FREERTOS_SUPPORT \
   OPTIONAL_INTERRUPTS_SUPPORT \
   OPTIONAL_RMT_SUPPORT \
   OPTIONAL_OLED_SUPPORT \
   OPTIONAL_SPI_FLASH_SUPPORT \
+  OPTIONAL_BOOT_IMAGE_SUPPORT \
+  OPTIONAL_XIP_SUPPORT \
+  OPTIONAL_PROFILER_SUPPORT \
+  OPTIONAL_SAMPLER_SUPPORT \
   CALLING_OPCODE_LIST \
-  FLOATING_POINT_LIST
+  FLOATING_POINT_LIST \
+  DOUBLE_CELL_LIST
+
+// Arenas behind allocate, free and resize.
+// An arena is one malloc'd block: this header, then memory handed out
+// by bumping used. Each allocation is rounded up to a power-of-two size
+// class and preceded by ARENA_HEADER bytes holding the class; freed
+// blocks go on their class's list for reuse. Requests past the largest
+// class, or that no longer fit, fall back to malloc.
+#define ARENA_CLASSES 8  // 16 .. 2048 bytes
+#define ARENA_HEADER 8
+#define ARENA_CLASS_SIZE(c) ((cell_t) 16 << (c))
+typedef struct ARENA {
+  struct ARENA *next;  // live arenas, searched by arena_owner()
+  char *base;
+  cell_t size, used;
+  void *free[ARENA_CLASSES];
+} ARENA;
+static ARENA *g_arenas;
+
+// Blocks of at least g_psram_threshold bytes that leave the arenas go
+// to PSRAM, keeping internal RAM for stacks, DMA and small hot buffers.
+// setup() zeroes it on boards without PSRAM; see psram-threshold.
+#define PSRAM_THRESHOLD 4096
+static cell_t g_psram_threshold = PSRAM_THRESHOLD;
+
+static void *heap_malloc(cell_t n) {
+  if (g_psram_threshold && n >= g_psram_threshold) {
+    void *p = heap_caps_malloc(n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (p) { return p; }
+  }
+  return malloc(n);
+}
+
+static void *heap_realloc(void *p, cell_t n) {
+  if (g_psram_threshold && n >= g_psram_threshold) {
+    void *q = heap_caps_realloc(p, n, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (q) { return q; }
+  }
+  return realloc(p, n);
+}
+
+static ARENA *arena_create(cell_t size) {
+  ARENA *a = (ARENA *) malloc(sizeof(ARENA) + size);
+  if (!a) { return 0; }
+  memset(a, 0, sizeof(ARENA));
+  a->base = (char *) (a + 1);
+  a->size = size;
+  a->next = g_arenas;
+  g_arenas = a;
+  return a;
+}
+
+static void arena_reset(ARENA *a) {
+  a->used = 0;
+  memset(a->free, 0, sizeof(a->free));
+}
+
+static void arena_delete(ARENA *a) {
+  ARENA **at = &g_arenas;
+  while (*at && *at != a) { at = &(*at)->next; }
+  if (*at) { *at = a->next; }
+  free(a);
+}
+
+static ARENA *arena_owner(void *p) {
+  for (ARENA *a = g_arenas; a; a = a->next) {
+    if ((char *) p >= a->base && (char *) p < a->base + a->size) { return a; }
+  }
+  return 0;
+}
+
+static void *arena_allocate(ARENA *a, cell_t n) {
+  if (!a || n > ARENA_CLASS_SIZE(ARENA_CLASSES - 1)) { return heap_malloc(n); }
+  cell_t c = 0;
+  while (ARENA_CLASS_SIZE(c) < n) { ++c; }
+  void *p = a->free[c];
+  if (p) {
+    a->free[c] = *(void **) p;
+    return p;
+  }
+  cell_t need = ARENA_HEADER + ARENA_CLASS_SIZE(c);
+  if (a->used + need > a->size) { return heap_malloc(n); }
+  char *h = a->base + a->used;
+  a->used += need;
+  *(cell_t *) h = c;
+  return h + ARENA_HEADER;
+}
+
+static void arena_free(void *p) {
+  ARENA *a = p ? arena_owner(p) : 0;
+  if (!a) {
+    free(p);
+    return;
+  }
+  cell_t c = *(cell_t *) ((char *) p - ARENA_HEADER);
+  *(void **) p = a->free[c];
+  a->free[c] = p;
+}
+
+static void *arena_resize(void *p, cell_t n, ARENA *current) {
+  if (!p) { return arena_allocate(current, n); }
+  if (!arena_owner(p)) { return heap_realloc(p, n); }
+  cell_t size = ARENA_CLASS_SIZE(*(cell_t *) ((char *) p - ARENA_HEADER));
+  if (n <= size) { return p; }
+  void *q = arena_allocate(current, n);
+  if (!q) { return 0; }
+  memcpy(q, p, size);
+  arena_free(p);
+  return q;
+}
+
+// Allocation tracking, while heap-track-on.
+// Each live block from allocate, resize or heap_caps_malloc is entered
+// in a hash table with its size and call site: the ip it will return to.
+// Sites keep a running total of what they hold, so a word that leaks
+// shows as live bytes that only grow. Blocks seen freed but never seen
+// allocated (from before tracking, or when the table was full) count
+// as strays. allocate, free and resize wrap the arena and heap words,
+// so those take their site from the return stack; heap_caps words use ip.
+// See .heap-report and .heap-json.
+#define HEAP_TRACK_BITS 10
+#define HEAP_TRACK_SLOTS (1 << HEAP_TRACK_BITS)
+#define HEAP_SITES 64
+#define HEAP_CLASSES 12  // up to 16, 32 .. 16384, then larger
+typedef struct { void *p; cell_t size; cell_t *site; } HEAP_BLOCK;
+typedef struct { cell_t *site; cell_t live, blocks, allocs; } HEAP_SITE;
+static struct {
+  cell_t live, peak, allocs, frees, dropped, strays, sites;
+  cell_t class_allocs[HEAP_CLASSES], class_live[HEAP_CLASSES];
+  HEAP_SITE site[HEAP_SITES];  // once full, new sites share site 0
+  HEAP_BLOCK *blocks;  // 0 while not tracking
+  cell_t tracked;
+} g_heap;
+
+static cell_t heap_slot(void *p) {
+  ucell_t x = (ucell_t) p >> 3;
+  return (uint32_t) ((x ^ (x >> 16)) * 0x9E3779B1u) >> (32 - HEAP_TRACK_BITS);
+}
+
+static cell_t heap_class(cell_t n) {
+  cell_t c = 0;
+  while (c < HEAP_CLASSES - 1 && ((cell_t) 16 << c) < n) { ++c; }
+  return c;
+}
+
+static HEAP_SITE *heap_site(cell_t *site) {
+  for (cell_t i = 0; i < g_heap.sites; ++i) {
+    if (g_heap.site[i].site == site) { return &g_heap.site[i]; }
+  }
+  if (site && g_heap.sites >= HEAP_SITES - 1) { return heap_site(0); }
+  HEAP_SITE *s = &g_heap.site[g_heap.sites++];
+  s->site = site;
+  return s;
+}
+
+static void heap_track_on(void) {
+  if (!g_heap.blocks) {
+    HEAP_BLOCK *blocks = (HEAP_BLOCK *) calloc(HEAP_TRACK_SLOTS, sizeof(HEAP_BLOCK));
+    memset(&g_heap, 0, sizeof(g_heap));
+    g_heap.blocks = blocks;
+  }
+}
+
+static void heap_track_off(void) {
+  free(g_heap.blocks);
+  g_heap.blocks = 0;
+  g_heap.tracked = 0;
+}
+
+static void heap_track_alloc(void *p, cell_t n, cell_t *site) {
+  if (!g_heap.blocks || !p) { return; }
+  cell_t c = heap_class(n);
+  ++g_heap.allocs;
+  ++g_heap.class_allocs[c];
+  // Keep a quarter of the table empty so probes stay short.
+  if (g_heap.tracked >= HEAP_TRACK_SLOTS * 3 / 4) {
+    ++g_heap.dropped;
+    return;
+  }
+  cell_t i = heap_slot(p);
+  while (g_heap.blocks[i].p) { i = (i + 1) & (HEAP_TRACK_SLOTS - 1); }
+  HEAP_SITE *s = heap_site(site);
+  g_heap.blocks[i].p = p;
+  g_heap.blocks[i].size = n;
+  g_heap.blocks[i].site = s->site;
+  ++g_heap.tracked;
+  ++g_heap.class_live[c];
+  g_heap.live += n;
+  if (g_heap.live > g_heap.peak) { g_heap.peak = g_heap.live; }
+  s->live += n;
+  ++s->blocks;
+  ++s->allocs;
+}
+
+static void heap_track_free(void *p) {
+  if (!g_heap.blocks || !p) { return; }
+  HEAP_BLOCK *b = g_heap.blocks;
+  cell_t i = heap_slot(p);
+  while (b[i].p && b[i].p != p) { i = (i + 1) & (HEAP_TRACK_SLOTS - 1); }
+  ++g_heap.frees;
+  if (!b[i].p) {
+    ++g_heap.strays;
+    return;
+  }
+  HEAP_SITE *s = heap_site(b[i].site);
+  s->live -= b[i].size;
+  --s->blocks;
+  --g_heap.class_live[heap_class(b[i].size)];
+  g_heap.live -= b[i].size;
+  --g_heap.tracked;
+  // Close the gap: pull back any later entry of the run whose home slot
+  // is not cyclically between the hole and itself.
+  for (cell_t j = i;;) {
+    j = (j + 1) & (HEAP_TRACK_SLOTS - 1);
+    if (!b[j].p) { break; }
+    cell_t k = heap_slot(b[j].p);
+    if (i <= j ? (i < k && k <= j) : (i < k || k <= j)) { continue; }
+    b[i] = b[j];
+    i = j;
+  }
+  b[i].p = 0;
+}
+
+static void heap_track_resize(void *p, void *q, cell_t n, cell_t *site) {
+  if (!q) { return; }
+  heap_track_free(p);
+  heap_track_alloc(q, n, site);
+}
+
+// Sites by live bytes, largest first, as cells of site, live, blocks, allocs.
+static cell_t heap_sites(void) {
+  for (cell_t i = 1; i < g_heap.sites; ++i) {
+    HEAP_SITE s = g_heap.site[i];
+    cell_t j = i;
+    for (; j > 0 && g_heap.site[j - 1].live < s.live; --j) {
+      g_heap.site[j] = g_heap.site[j - 1];
+    }
+    g_heap.site[j] = s;
+  }
+  return g_heap.sites;
+}
 
 #define REQUIRED_MEMORY_SUPPORT \
   YV(internals, MALLOC, SET malloc(n0)) \
   YV(internals, SYSFREE, free(a0); DROP) \
   YV(internals, REALLOC, SET realloc(a1, n0); NIP) \
-  YV(internals, heap_caps_malloc, SET heap_caps_malloc(n1, n0); NIP) \
-  YV(internals, heap_caps_free, heap_caps_free(a0); DROP) \
-  YV(internals, heap_caps_realloc, \
-      tos = (cell_t) heap_caps_realloc(a2, n1, n0); NIPn(2))
+  YV(internals, heap_caps_malloc, w = n1; SET heap_caps_malloc(n1, n0); NIP; \
+      heap_track_alloc(a0, w, ip)) \
+  YV(internals, heap_caps_free, heap_track_free(a0); heap_caps_free(a0); DROP) \
+  YV(internals, heap_caps_realloc, w = (cell_t) heap_caps_realloc(a2, n1, n0); \
+      heap_track_resize(a2, (void *) w, n1, ip); tos = w; NIPn(2)) \
+  XV(internals, "arena-create", ARENA_CREATE, SET arena_create(n0)) \
+  X("arena-reset", ARENA_RESET, arena_reset((ARENA *) a0); DROP) \
+  X("arena-delete", ARENA_DELETE, arena_delete((ARENA *) a0); DROP) \
+  XV(internals, "arena-allocate", ARENA_ALLOCATE, w = n1; \
+      SET arena_allocate((ARENA *) a0, n1); NIP; \
+      heap_track_alloc(a0, w, (cell_t *) *rp)) \
+  XV(internals, "arena-free", ARENA_FREE, \
+      heap_track_free(a0); arena_free(a0); DROP) \
+  XV(internals, "arena-resize", ARENA_RESIZE, \
+      w = (cell_t) arena_resize(a2, n1, (ARENA *) a0); \
+      heap_track_resize(a2, (void *) w, n1, (cell_t *) *rp); tos = w; NIPn(2)) \
+  XV(internals, "heap-allocate", HEAP_ALLOCATE, w = n1; \
+      SET heap_caps_malloc(n1, n0); NIP; heap_track_alloc(a0, w, (cell_t *) *rp)) \
+  XV(internals, "heap-resize", HEAP_RESIZE, \
+      w = (cell_t) heap_caps_realloc(a2, n1, n0); \
+      heap_track_resize(a2, (void *) w, n1, (cell_t *) *rp); tos = w; NIPn(2)) \
+  X("psram-threshold", PSRAM_THRESH, PUSH &g_psram_threshold) \
+  X("heap-track-on", HEAP_TRACK_ON, heap_track_on()) \
+  X("heap-track-off", HEAP_TRACK_OFF, heap_track_off()) \
+  XV(internals, "'heap-stats", THEAP_STATS, PUSH &g_heap) \
+  XV(internals, "heap-sites", HEAPSITES, PUSH g_heap.site; PUSH heap_sites())
 
 #define REQUIRED_ESP_SUPPORT \
   YV(ESP, getHeapSize, PUSH ESP.getHeapSize()) \
@@ -616,6 +1064,80 @@ static cell_t ResizeFile(cell_t fd, cell_t size);
   Y(dacWrite, dacWrite(n1, n0); DROPn(2))
 #endif
 
+#ifndef ENABLE_BOOT_IMAGE_SUPPORT
+# define OPTIONAL_BOOT_IMAGE_SUPPORT
+#else
+# ifndef BOOT_IMAGE_PATH
+#  define BOOT_IMAGE_PATH "/spiffs/boot.img"
+# endif
+# define OPTIONAL_BOOT_IMAGE_SUPPORT \
+  XV(internals, "boot-image-path", BOOT_IMAGE_NAME, \
+      PUSH BOOT_IMAGE_PATH; PUSH sizeof(BOOT_IMAGE_PATH) - 1)
+#endif
+
+#ifndef ENABLE_XIP_SUPPORT
+# define OPTIONAL_XIP_SUPPORT
+#else
+# ifdef ESP_PLATFORM
+#  include "esp_partition.h"
+# endif
+# ifndef XIP_PARTITION
+#  ifdef ESP_PLATFORM
+#   define XIP_PARTITION "forth"  // partition label
+#  else
+#   define XIP_PARTITION "forth.xip"  // a file, which must exist
+#  endif
+# endif
+static struct {
+  const char *map, *words;  // the mapped partition, and the frozen words in it
+  cell_t size, frozen;
+} g_xip;
+# define OPTIONAL_XIP_SUPPORT \
+  XV(internals, "xip-region", XIP_REGION, PUSH g_xip.words; PUSH g_xip.frozen)
+#endif
+
+#ifndef ENABLE_PROFILER_SUPPORT
+# define OPTIONAL_PROFILER_SUPPORT
+# define PROFILE_TAIL
+#else
+static cell_t g_profiling;
+// TAIL enters its word without dispatching it, so counts it here.
+# define PROFILE_TAIL if (g_profiling) { profile_hit(*ip); }
+static void profile_hit(cell_t xt);
+static void profile_reset(void);
+static cell_t profile_sort(cell_t column, cell_t *ret);
+# define OPTIONAL_PROFILER_SUPPORT \
+  X("profile-on", PROFILE_ON, profile_hit(0); g_profiling = 1) \
+  X("profile-off", PROFILE_OFF, profile_hit(0); g_profiling = 0) \
+  X("profile-reset", PROFILE_RESET, profile_reset()) \
+  XV(internals, "profile-sorted", PROFILE_SORTED, \
+      cell_t a; w = profile_sort(tos, &a); tos = a; PUSH w)
+#endif
+
+#ifndef ENABLE_SAMPLER_SUPPORT
+# define OPTIONAL_SAMPLER_SUPPORT
+#else
+# define SAMPLE_SLOTS 1024
+static cell_t *volatile g_sample_ip, *volatile g_sample_isr_ip;
+static cell_t *g_samples[SAMPLE_SLOTS];
+static volatile cell_t g_sample_count;
+static void sample_record(cell_t *ip);
+# ifdef ESP_PLATFORM
+#  define OPTIONAL_SAMPLER_TIMER
+# else
+static void sample_start(cell_t usec);
+#  define OPTIONAL_SAMPLER_TIMER \
+  X("sample-start", SAMPLE_START, sample_start(n1); DROPn(2)) \
+  X("sample-stop", SAMPLE_STOP, sample_start(0))
+# endif
+# define OPTIONAL_SAMPLER_SUPPORT \
+  OPTIONAL_SAMPLER_TIMER \
+  XV(internals, "sample", SAMPLE, sample_record(g_sample_isr_ip)) \
+  XV(internals, "'samples", TSAMPLES, PUSH g_samples; \
+      PUSH g_sample_count < SAMPLE_SLOTS ? g_sample_count : SAMPLE_SLOTS) \
+  X("samples-reset", SAMPLES_RESET, g_sample_count = 0)
+#endif
+
 #ifndef ENABLE_SPI_FLASH_SUPPORT
 # define OPTIONAL_SPI_FLASH_SUPPORT
 #else
@@ -859,6 +1381,148 @@ static cell_t TimerIsrRegister(cell_t group, cell_t timer, cell_t xt, cell_t arg
   XV(sockets, "errno", ERRNO, PUSH errno)
 #endif
 
+#ifndef ENABLE_POSIX_SUPPORT
+# define OPTIONAL_POSIX_SUPPORT
+#else
+# ifndef SIM_PRINT_ONLY
+#  include <sys/mman.h>
+# endif
+# define OPTIONAL_POSIX_SUPPORT \
+  YV(posix, mmap, n0 = (cell_t) mmap(a5, n4, n3, n2, n1, n0); NIPn(5)) \
+  YV(posix, munmap, n0 = munmap(a1, n0); NIP) \
+  YV(posix, PROT_READ, PUSH PROT_READ) \
+  YV(posix, PROT_WRITE, PUSH PROT_WRITE) \
+  YV(posix, PROT_EXEC, PUSH PROT_EXEC) \
+  YV(posix, MAP_PRIVATE, PUSH MAP_PRIVATE) \
+  YV(posix, MAP_ANONYMOUS, PUSH MAP_ANONYMOUS)
+#endif
+
+#ifndef ENABLE_ARRAYS_SUPPORT
+# define OPTIONAL_ARRAYS_SUPPORT
+#else
+# if defined(__XTENSA__)
+#  include <xtensa/config/core-isa.h>
+# endif
+// Kernels over contiguous int32_t, int16_t and float buffers.
+// Element-wise loops are left to the compiler to unroll; reductions
+// keep four partial sums so the adds do not wait on each other.
+# define ARRAY_UNROLL _Pragma("GCC unroll 4")
+# define ARRAY_KERNELS(P, T, ACC) \
+static void P ## _fill(T *a, cell_t n, T x) { \
+  ARRAY_UNROLL for (cell_t i = 0; i < n; ++i) { a[i] = x; } \
+} \
+static void P ## _add(const T *a, const T *b, T *d, cell_t n) { \
+  ARRAY_UNROLL for (cell_t i = 0; i < n; ++i) { d[i] = a[i] + b[i]; } \
+} \
+static void P ## _scale(const T *a, T *d, cell_t n, T k) { \
+  ARRAY_UNROLL for (cell_t i = 0; i < n; ++i) { d[i] = a[i] * k; } \
+} \
+static void P ## _saxpy(const T *x, T *y, cell_t n, T k) { \
+  ARRAY_UNROLL for (cell_t i = 0; i < n; ++i) { y[i] += k * x[i]; } \
+} \
+static ACC P ## _sum(const T *a, cell_t n) { \
+  ACC s0 = 0, s1 = 0, s2 = 0, s3 = 0; \
+  cell_t i = 0; \
+  for (; i + 4 <= n; i += 4) { \
+    s0 += a[i]; s1 += a[i + 1]; s2 += a[i + 2]; s3 += a[i + 3]; \
+  } \
+  for (; i < n; ++i) { s0 += a[i]; } \
+  return (s0 + s1) + (s2 + s3); \
+} \
+static ACC P ## _dot(const T *a, const T *b, cell_t n) { \
+  ACC s0 = 0, s1 = 0, s2 = 0, s3 = 0; \
+  cell_t i = 0; \
+  for (; i + 4 <= n; i += 4) { \
+    s0 += (ACC) a[i] * b[i]; s1 += (ACC) a[i + 1] * b[i + 1]; \
+    s2 += (ACC) a[i + 2] * b[i + 2]; s3 += (ACC) a[i + 3] * b[i + 3]; \
+  } \
+  for (; i < n; ++i) { s0 += (ACC) a[i] * b[i]; } \
+  return (s0 + s1) + (s2 + s3); \
+} \
+static T P ## _min(const T *a, cell_t n) { \
+  T m = n ? a[0] : 0; \
+  for (cell_t i = 1; i < n; ++i) { if (a[i] < m) { m = a[i]; } } \
+  return m; \
+} \
+static T P ## _max(const T *a, cell_t n) { \
+  T m = n ? a[0] : 0; \
+  for (cell_t i = 1; i < n; ++i) { if (a[i] > m) { m = a[i]; } } \
+  return m; \
+} \
+/* d[i] is the mean of a[i] .. a[i + w - 1], for n - w + 1 outputs; */ \
+/* d may be a, as each input is read before its slot is written. */ \
+static void P ## _avg(const T *a, T *d, cell_t n, cell_t w) { \
+  if (w <= 0 || w > n) { return; } \
+  ACC s = 0; \
+  for (cell_t i = 0; i < w; ++i) { s += a[i]; } \
+  T oldest = a[0]; \
+  d[0] = (T) (s / w); \
+  for (cell_t i = w; i < n; ++i) { \
+    s += a[i]; s -= oldest; \
+    oldest = a[i - w + 1]; \
+    d[i - w + 1] = (T) (s / w); \
+  } \
+}
+ARRAY_KERNELS(i32, int32_t, int64_t)
+ARRAY_KERNELS(i16, int16_t, int64_t)
+ARRAY_KERNELS(f32, float, float)
+# if defined(__XTENSA__) && XCHAL_HAVE_MAC16
+// The MAC16 option multiplies 16-bit halves into a 40-bit accumulator.
+// A product is at most 2^30, so ACC is drained into an int64_t after
+// every MAC16_BLOCK of them, well before it could overflow.
+#  define I16_DOT i16_dot_mac16
+#  define MAC16_BLOCK 256
+static int64_t i16_dot_mac16(const int16_t *a, const int16_t *b, cell_t n) {
+  int64_t sum = 0;
+  while (n > 0) {
+    cell_t m = n < MAC16_BLOCK ? n : MAC16_BLOCK;
+    int32_t lo, hi;
+    n -= m;
+    __asm__ __volatile__("wsr %0, acclo\n wsr %0, acchi" : : "r"(0));
+    for (; m >= 4; m -= 4, a += 4, b += 4) {
+      __asm__ __volatile__("mula.aa.ll %0, %1\n mula.aa.ll %2, %3\n"
+                           "mula.aa.ll %4, %5\n mula.aa.ll %6, %7"
+          : : "r"(a[0]), "r"(b[0]), "r"(a[1]), "r"(b[1]),
+              "r"(a[2]), "r"(b[2]), "r"(a[3]), "r"(b[3]));
+    }
+    for (; m; --m) {
+      __asm__ __volatile__("mula.aa.ll %0, %1" : : "r"(*a++), "r"(*b++));
+    }
+    __asm__ __volatile__("rsr %0, acclo\n rsr %1, acchi" : "=r"(lo), "=r"(hi));
+    sum += ((int64_t) (int8_t) hi << 32) | (uint32_t) lo;
+  }
+  return sum;
+}
+# else
+#  define I16_DOT i16_dot
+# endif
+# define ARRAY_WORDS(P, T) \
+  YV(arrays, P ## fill, P ## _fill((T *) a2, n1, n0); DROPn(3)) \
+  YV(arrays, P ## add, P ## _add((T *) a3, (T *) a2, (T *) a1, n0); DROPn(4)) \
+  YV(arrays, P ## scale, P ## _scale((T *) a3, (T *) a2, n1, n0); DROPn(4)) \
+  YV(arrays, P ## saxpy, P ## _saxpy((T *) a3, (T *) a2, n1, n0); DROPn(4)) \
+  YV(arrays, P ## sum, dcell_t d = P ## _sum((T *) a1, n0); DSET(d)) \
+  YV(arrays, P ## min, tos = P ## _min((T *) a1, n0); NIP) \
+  YV(arrays, P ## max, tos = P ## _max((T *) a1, n0); NIP) \
+  YV(arrays, P ## avg, P ## _avg((T *) a3, (T *) a2, n1, n0); DROPn(4))
+# define OPTIONAL_ARRAYS_SUPPORT \
+  ARRAY_WORDS(i32, int32_t) \
+  ARRAY_WORDS(i16, int16_t) \
+  YV(arrays, i32dot, dcell_t d = i32_dot((int32_t *) a2, (int32_t *) a1, n0); \
+                     DROP; DSET(d)) \
+  YV(arrays, i16dot, dcell_t d = I16_DOT((int16_t *) a2, (int16_t *) a1, n0); \
+                     DROP; DSET(d)) \
+  YV(arrays, f32fill, f32_fill((float *) a1, n0, *fp--); DROPn(2)) \
+  YV(arrays, f32add, f32_add((float *) a3, (float *) a2, (float *) a1, n0); DROPn(4)) \
+  YV(arrays, f32scale, f32_scale((float *) a2, (float *) a1, n0, *fp--); DROPn(3)) \
+  YV(arrays, f32saxpy, f32_saxpy((float *) a2, (float *) a1, n0, *fp--); DROPn(3)) \
+  YV(arrays, f32sum, *++fp = f32_sum((float *) a1, n0); DROPn(2)) \
+  YV(arrays, f32dot, *++fp = f32_dot((float *) a2, (float *) a1, n0); DROPn(3)) \
+  YV(arrays, f32min, *++fp = f32_min((float *) a1, n0); DROPn(2)) \
+  YV(arrays, f32max, *++fp = f32_max((float *) a1, n0); DROPn(2)) \
+  YV(arrays, f32avg, f32_avg((float *) a3, (float *) a2, n1, n0); DROPn(4))
+#endif
+
 #ifndef ENABLE_SD_SUPPORT
 # define OPTIONAL_SD_SUPPORT
 #else
@@ -1056,9 +1720,15 @@ typedef struct {
 
   // Layout not used by Forth.
   cell_t *rp;  // spot to park main thread
-  cell_t DOLIT_XT, DOFLIT_XT, DOEXIT_XT, YIELD_XT;
-  void *DOCREATE_OP;
+  cell_t DOLIT_XT, DOFLIT_XT, DOEXIT_XT, YIELD_XT, TAIL_XT;
+  void *DOCREATE_OP, *DOCOL_OP;
   const BUILTIN_WORD *builtins;
+  cell_t *fusions;  // (link, first, second, fused) entries, see compile()
+  cell_t *inlines;  // (link, xt) entries, see inline_mark()
+  cell_t *catch_ip;  // CATCH returns through this, see forth_init()
+  char *hld;  // pictured numeric output, grows down from pad
+  cell_t *heap_limit;  // end of the segment here is in
+  struct DICT_SEGMENT *segment;  // newest chained segment, or 0
 } G_SYS;
 #define PRINT_ERRORS 0
 
@@ -1071,6 +1741,7 @@ typedef struct {
 #define SMUDGE 2
 #define BUILTIN_FORK 4
 #define BUILTIN_MARK 8
+#define NONAMED 16
 
 // Maximum ALSO layers.
 #define VOCABULARY_DEPTH 16
@@ -1092,6 +1763,7 @@ enum {
 };
 
 static G_SYS *g_sys = 0;
+static cell_t g_boot_checkpoint = 0;
 
 static cell_t convert(const char *pos, cell_t n, cell_t base, cell_t *ret) {
   *ret = 0;
@@ -1113,21 +1785,82 @@ static cell_t convert(const char *pos, cell_t n, cell_t base, cell_t *ret) {
   return -1;
 }
 
+// Exact powers of ten; larger scales are applied 1e22 at a time.
+static const double g_pow10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// p is x rounded to the nearest double, err has the sign of x - p.
+// Rounded to odd instead, a double holds x closely enough that a
+// further rounding to float is as though x were rounded once.
+static double round_odd(double p, double err) {
+  uint64_t bits;
+  memcpy(&bits, &p, sizeof(bits));
+  if (err == 0 || (bits & 1)) { return p; }
+  return nextafter(p, err > 0 ? INFINITY : -INFINITY);
+}
+
+// Correctly rounded while the mantissa and the power of ten are exact
+// doubles, as for any literal of up to 15 digits and exponent up to 22.
+// Past that, the steps each round and the last bit may be off.
+static float fscale(uint64_t mantissa, cell_t exp) {
+  double ret = (double) mantissa;
+  if (mantissa < (1ull << 53) && exp >= -22 && exp <= 22) {
+    double m = ret, p = g_pow10[exp < 0 ? -exp : exp];
+    if (exp < 0) {
+      ret = m / p;
+      return (float) round_odd(ret, fma(-ret, p, m));
+    }
+    ret = m * p;
+    return (float) round_odd(ret, fma(m, p, -ret));
+  }
+  for (; exp > 22; exp -= 22) { ret *= 1e22; }
+  for (; exp < -22; exp += 22) { ret /= 1e22; }
+  ret = exp < 0 ? ret / g_pow10[-exp] : ret * g_pow10[exp];
+  return (float) ret;
+}
+
+// A double literal: convert() digits with a trailing '.'.
+static cell_t dconvert(const char *pos, cell_t n, cell_t base, dcell_t *ret) {
+  udcell_t u = 0;
+  cell_t negate = 0;
+  if (n < 2 || pos[n - 1] != '.') { return 0; }
+  --n;
+  if (*pos == '-') { negate = -1; ++pos; --n; }
+  if (n && *pos == '$') { base = 16; ++pos; --n; }
+  if (!n) { return 0; }
+  for (; n; --n) {
+    uintptr_t d = UPPER(*pos) - '0';
+    if (d > 9) {
+      d -= 7;
+      if (d < 10) { return 0; }
+    }
+    if (d >= (uintptr_t) base) { return 0; }
+    u = u * base + d;
+    ++pos;
+  }
+  *ret = (dcell_t) (negate ? -u : u);
+  return -1;
+}
+
 static cell_t fconvert(const char *pos, cell_t n, float *ret) {
   *ret = 0;
+  uint64_t mantissa = 0;
   cell_t negate = 0;
   cell_t has_dot = 0;
   cell_t exp = 0;
-  float shift = 1.0;
+  cell_t shift = 0;
   if (!n) { return 0; }
   if (*pos == '-') { negate = -1; ++pos; --n; }
   for (; n; --n) {
     if (*pos >= '0' && *pos <= '9') {
-      if (has_dot) {
-        shift = shift * 0.1f;
-        *ret = *ret + (*pos - '0') * shift;
-      } else {
-        *ret = *ret * 10 + (*pos - '0');
+      // Digits past the 18th are below float precision; only count them.
+      if (mantissa < 100000000000000000ull) {
+        mantissa = mantissa * 10 + (*pos - '0');
+        if (has_dot) { --shift; }
+      } else if (!has_dot) {
+        ++shift;
       }
     } else if (*pos == 'e' || *pos == 'E') {
       break;
@@ -1145,42 +1878,532 @@ static cell_t fconvert(const char *pos, cell_t n, float *ret) {
     if (!convert(pos, n, 10, &exp)) { return 0; }
   }
   if (exp < -128 || exp > 128) { return 0; }
-  for (; exp < 0; ++exp) { *ret *= 0.1f; }
-  for (; exp > 0; --exp) { *ret *= 10.0f; }
+  *ret = fscale(mantissa, exp + shift);
   if (negate) { *ret = -*ret; }
   return -1;
 }
 
-static cell_t same(const char *a, const char *b, cell_t len) {
+#define FFORMAT_PRECISION 9
+
+// Fixed-point text for f. with prec decimals, rounded to nearest.
+static cell_t fformat(float f, cell_t prec, char *out) {
+  char *pos = out;
+  if (isnan(f)) { memcpy(out, "nan", 3); return 3; }
+  if (f < 0) { *pos++ = '-'; f = -f; }
+  if (isinf(f)) { memcpy(pos, "inf", 3); return pos + 3 - out; }
+  if (prec < 0) { prec = 0; }
+  if (prec > FFORMAT_PRECISION) { prec = FFORMAT_PRECISION; }
+  uint64_t whole, frac = 0;
+  cell_t zeros = 0;
+  // 24 bits of f times the at most 21-bit odd part of 10^prec: exact,
+  // so rounding to prec decimals below is the only rounding.
+  double scaled = (double) f * g_pow10[prec];
+  if (scaled < 1e18) {
+    uint64_t n = (uint64_t) scaled;
+    if (scaled - (double) n >= 0.5) { ++n; }
+    uint64_t unit = (uint64_t) g_pow10[prec];
+    whole = n / unit;
+    frac = n % unit;
+  } else {
+    // Beyond 2^24 a float is a whole number; keep its leading digits.
+    while (f / g_pow10[zeros] >= 1e18) { ++zeros; }
+    whole = (uint64_t) (f / g_pow10[zeros]);  // f itself, or past 2^53: whole
+  }
+  char digits[20];
+  cell_t len = 0;
+  do { digits[len++] = '0' + whole % 10; whole /= 10; } while (whole);
+  while (len) { *pos++ = digits[--len]; }
+  for (; zeros; --zeros) { *pos++ = '0'; }
+  *pos++ = '.';
+  for (cell_t i = prec; i; --i) { pos[i - 1] = '0' + frac % 10; frac /= 10; }
+  pos += prec;
+  return pos - out;
+}
+
+// Holds the low digit of u in base and returns the rest.
+static ucell_t hold_digit(ucell_t u) {
+  ucell_t base = g_sys->base;
+  ucell_t d = u % base;
+  *--g_sys->hld = d > 9 ? d - 10 + 'A' : d + '0';
+  return u / base;
+}
+
+static udcell_t hold_ddigit(udcell_t u) {
+  ucell_t base = g_sys->base;
+  ucell_t d = u % base;
+  *--g_sys->hld = d > 9 ? d - 10 + 'A' : d + '0';
+  return u / base;
+}
+
+// d * m / n through a triple-cell product, floored like */.
+static dcell_t mstarslash(dcell_t d, cell_t m, cell_t n) {
+  int negative = (d < 0) ^ (m < 0) ^ (n < 0);
+  udcell_t ud = d < 0 ? -(udcell_t) d : (udcell_t) d;
+  ucell_t um = m < 0 ? -(ucell_t) m : (ucell_t) m;
+  ucell_t un = n < 0 ? -(ucell_t) n : (ucell_t) n;
+  udcell_t lo = (udcell_t) (ucell_t) ud * um;
+  udcell_t hi = (udcell_t) (ucell_t) (ud >> DCELL_BITS) * um + (lo >> DCELL_BITS);
+  udcell_t x = (hi % un) << DCELL_BITS | (ucell_t) lo;
+  udcell_t q = (hi / un) << DCELL_BITS | x / un;
+  if (negative) { q = x % un ? -(q + 1) : -q; }
+  return (dcell_t) q;
+}
+
+static cell_t same_bytes(const char *a, const char *b, cell_t len) {
   for (;len && UPPER(*a) == UPPER(*b); --len, ++a, ++b);
   return len == 0;
 }
 
-static cell_t find(const char *name, cell_t len) {
-  for (cell_t ***voc = g_sys->context; *voc; ++voc) {
-    cell_t xt = (cell_t) **voc;
-    while (xt) {
-      if ((*TOFLAGS(xt) & BUILTIN_FORK)) {
-        cell_t vocab = TOLINK(xt)[3];
-        for (int i = 0; g_sys->builtins[i].name; ++i) {
-          if (g_sys->builtins[i].vocabulary == vocab &&
-              len == g_sys->builtins[i].name_length &&
-              same(name, g_sys->builtins[i].name, len)) {
-            return (cell_t) &g_sys->builtins[i].code;
-          }
-        }
+// Case-insensitive compare a cell at a time; only cells that differ
+// are folded byte by byte.
+static cell_t same(const char *a, const char *b, cell_t len) {
+  cell_t x, y;
+  for (; len >= (cell_t) sizeof(cell_t);
+       len -= sizeof(cell_t), a += sizeof(cell_t), b += sizeof(cell_t)) {
+    memcpy(&x, a, sizeof(x));
+    memcpy(&y, b, sizeof(y));
+    if (x != y && !same_bytes(a, b, sizeof(cell_t))) { return 0; }
+  }
+  return same_bytes(a, b, len);
+}
+
+static cell_t mem_compare(const char *a, cell_t alen,
+                          const char *b, cell_t blen) {
+  int r = memcmp(a, b, alen < blen ? alen : blen);
+  if (r) { return r < 0 ? -1 : 1; }
+  return alen < blen ? -1 : alen > blen ? 1 : 0;
+}
+
+// Offset of the first b in a, or -1.
+static cell_t mem_search(const char *a, cell_t alen,
+                         const char *b, cell_t blen) {
+  if (!blen) { return 0; }
+  if (blen > alen) { return -1; }
+  const char *end = a + alen - blen + 1;
+  for (const char *p = a; p < end; ++p) {
+    p = (const char *) memchr(p, *b, end - p);
+    if (!p) { break; }
+    if (!memcmp(p, b, blen)) { return p - a; }
+  }
+  return -1;
+}
+
+// Dictionary hash index.
+// Each wordlist (named by the address of its head cell) gets a record with
+// the head it was last indexed at, the parent it chains into, and the
+// builtin forks in it. Words live in one shared hash table of nodes whose
+// stamps follow chain order, so the newest visible match wins exactly as
+// in a linear walk. Small wordlists (like the locals scope) are walked.
+// Dictionary segments.
+// The dictionary starts in the block given to forth_init and chains
+// further malloc'd segments on as it fills: create (or room, for a
+// bigger body) opens a new one when less than DICT_MARGIN would remain,
+// but only while here is in the newest segment. A word is never moved,
+// so an allot or comma that would leave less than DICT_PAD throws.
+// forget frees the segments it leaves empty (see dict_release).
+#define DICT_SEGMENT_SIZE 16384
+#define DICT_PAD 1280  // room for pad, and a block copied through it
+#define DICT_MARGIN (2 * DICT_PAD)
+typedef struct DICT_SEGMENT {
+  struct DICT_SEGMENT *prev;
+  cell_t *below;  // here in the previous segment when this one began
+  cell_t size;
+} DICT_SEGMENT;
+
+static cell_t *segment_start(DICT_SEGMENT *s) {
+  return s ? (cell_t *) (s + 1) : g_sys->heap_start;
+}
+
+static cell_t *segment_limit(DICT_SEGMENT *s) {
+  return s ? (cell_t *) ((char *) (s + 1) + s->size)
+           : (cell_t *) ((char *) g_sys->heap_start + g_sys->heap_size);
+}
+
+// Is a in the used part of any segment?
+static int in_dictionary(cell_t a) {
+  cell_t *top = g_sys->heap;
+  for (DICT_SEGMENT *s = g_sys->segment; s; s = s->prev) {
+    if (a >= (cell_t) (s + 1) && a < (cell_t) top) { return 1; }
+    top = s->below;
+  }
+  return a >= (cell_t) g_sys->heap_start && a < (cell_t) top;
+}
+
+// Bytes used from a, in the first segment, through here.
+static cell_t dict_span(cell_t *a) {
+  cell_t n = 0;
+  cell_t *top = g_sys->heap;
+  for (DICT_SEGMENT *s = g_sys->segment; s; s = s->prev) {
+    n += (char *) top - (char *) (s + 1);
+    top = s->below;
+  }
+  return n + ((char *) top - (char *) a);
+}
+
+#define DICT_BUCKETS 512
+#define DICT_WORDLISTS 64
+#define DICT_FORKS 8
+#define DICT_LINEAR 16
+
+typedef struct {
+  cell_t xt;
+  uint32_t stamp;
+  int32_t next;
+  uint16_t wordlist;
+} DICT_NODE;
+
+typedef struct {
+  cell_t *head_cell, head, *parent;
+  cell_t count, linear, nforks;
+  cell_t forks[DICT_FORKS];
+  uint32_t fork_stamps[DICT_FORKS];
+} DICT_WORDLIST;
+
+static struct {
+  int32_t buckets[DICT_BUCKETS];
+  DICT_WORDLIST wordlists[DICT_WORDLISTS];
+  DICT_NODE *nodes;
+  int32_t capacity, used, free;
+  uint32_t stamp;
+  int disabled;
+} g_dict;
+
+static uint32_t name_hash(const char *name, cell_t len) {
+  uint32_t h = 5381;
+  for (; len; --len, ++name) { h = h * 33 + UPPER(*name); }
+  return h;
+}
+
+static uint32_t dict_hash(const char *name, cell_t len) {
+  return name_hash(name, len) % DICT_BUCKETS;
+}
+
+static int dict_boundary(cell_t xt) {
+  return !*TONAMELEN(xt) && !(*TOFLAGS(xt) & (NONAMED | BUILTIN_FORK));
+}
+
+// Free the segments newer than the one here is in, as after forget.
+static void dict_release(void) {
+  DICT_SEGMENT *s = g_sys->segment;
+  while (s && (g_sys->heap < segment_start(s) || g_sys->heap > segment_limit(s))) {
+    s = s->prev;
+  }
+  if (!s && (g_sys->heap < g_sys->heap_start || g_sys->heap > segment_limit(0))) { return; }
+  while (g_sys->segment != s) {
+    DICT_SEGMENT *newest = g_sys->segment;
+    g_sys->segment = newest->prev;
+    free(newest);
+  }
+  if (s && g_sys->heap == segment_start(s)) {  // emptied too
+    g_sys->heap = s->below;
+    g_sys->segment = s->prev;
+    free(s);
+  }
+  g_sys->heap_limit = segment_limit(g_sys->segment);
+}
+
+static void dict_reset(void) {
+  dict_release();
+  if (g_sys->latestxt && !in_dictionary((cell_t) g_sys->latestxt)) { g_sys->latestxt = 0; }
+  // forget may have released the newest INLINE entries.
+  while (g_sys->inlines && !in_dictionary((cell_t) g_sys->inlines)) {
+    g_sys->inlines = (cell_t *) *g_sys->inlines;
+  }
+  for (int i = 0; i < DICT_BUCKETS; ++i) { g_dict.buckets[i] = -1; }
+  memset(g_dict.wordlists, 0, sizeof(g_dict.wordlists));
+  g_dict.used = 0;
+  g_dict.free = -1;
+}
+
+static DICT_WORDLIST *dict_wordlist(cell_t *head_cell, int add) {
+  cell_t i = (((ucell_t) head_cell) / sizeof(cell_t)) % DICT_WORDLISTS;
+  for (cell_t n = 0; n < DICT_WORDLISTS; ++n, i = (i + 1) % DICT_WORDLISTS) {
+    DICT_WORDLIST *wl = &g_dict.wordlists[i];
+    if (wl->head_cell == head_cell) { return wl; }
+    if (!wl->head_cell) {
+      if (!add) { return 0; }
+      wl->head_cell = head_cell;
+      wl->head = ~*head_cell;  // Force a build on first use.
+      wl->linear = -1;
+      return wl;
+    }
+  }
+  return 0;
+}
+
+static void dict_insert(DICT_WORDLIST *wl, cell_t xt, uint32_t stamp) {
+  if (*TOFLAGS(xt) & BUILTIN_FORK) {
+    if (wl->nforks == DICT_FORKS) { wl->linear = -1; return; }
+    wl->forks[wl->nforks] = xt;
+    wl->fork_stamps[wl->nforks++] = stamp;
+  }
+  if (!*TONAMELEN(xt)) { return; }
+  int32_t n = g_dict.free;
+  if (n >= 0) {
+    g_dict.free = g_dict.nodes[n].next;
+  } else {
+    if (g_dict.used == g_dict.capacity) {
+      int32_t capacity = g_dict.capacity ? g_dict.capacity * 2 : 256;
+      DICT_NODE *nodes = (DICT_NODE *) realloc(g_dict.nodes, capacity * sizeof(DICT_NODE));
+      if (!nodes) { g_dict.disabled = -1; return; }
+      g_dict.nodes = nodes;
+      g_dict.capacity = capacity;
+    }
+    n = g_dict.used++;
+  }
+  uint32_t h = dict_hash(TONAME(xt), *TONAMELEN(xt));
+  g_dict.nodes[n].xt = xt;
+  g_dict.nodes[n].stamp = stamp;
+  g_dict.nodes[n].wordlist = wl - g_dict.wordlists;
+  g_dict.nodes[n].next = g_dict.buckets[h];
+  g_dict.buckets[h] = n;
+}
+
+static void dict_drop(DICT_WORDLIST *wl) {
+  uint16_t index = wl - g_dict.wordlists;
+  for (int i = 0; i < DICT_BUCKETS; ++i) {
+    int32_t *n = &g_dict.buckets[i];
+    while (*n >= 0) {
+      DICT_NODE *node = &g_dict.nodes[*n];
+      if (node->wordlist == index) {
+        int32_t dead = *n;
+        *n = node->next;
+        node->next = g_dict.free;
+        g_dict.free = dead;
+      } else {
+        n = &node->next;
       }
-      if (!(*TOFLAGS(xt) & SMUDGE) &&
-          len == *TONAMELEN(xt) &&
-          same(name, TONAME(xt), len)) {
-        return xt;
+    }
+  }
+}
+
+static void dict_build(DICT_WORDLIST *wl) {
+  if (!wl->linear) { dict_drop(wl); }
+  wl->head = *wl->head_cell;
+  wl->parent = 0;
+  wl->count = 0;
+  wl->nforks = 0;
+  cell_t xt = wl->head;
+  for (; xt && !dict_boundary(xt); xt = *TOLINK(xt)) { ++wl->count; }
+  if (xt) { wl->parent = TOLINK(xt); }
+  wl->linear = wl->count < DICT_LINEAR ? -1 : 0;
+  if (wl->linear) { return; }
+  uint32_t stamp = g_dict.stamp + wl->count;
+  g_dict.stamp = stamp + 1;
+  for (xt = wl->head; xt && !dict_boundary(xt); xt = *TOLINK(xt)) {
+    dict_insert(wl, xt, stamp--);
+  }
+  if (wl->linear) { dict_drop(wl); wl->nforks = 0; return; }
+  for (cell_t i = 0, j = wl->nforks - 1; i < j; ++i, --j) {
+    cell_t t = wl->forks[i]; wl->forks[i] = wl->forks[j]; wl->forks[j] = t;
+    uint32_t s = wl->fork_stamps[i];
+    wl->fork_stamps[i] = wl->fork_stamps[j]; wl->fork_stamps[j] = s;
+  }
+}
+
+// Builtin index.
+// Keys for (vocabulary, name) are computed at compile time, in the same
+// order as the builtins[] table in forth_run. The open addressing table
+// is filled once at startup; probing finds the earliest entry for a key,
+// matching the old first-match linear scan.
+#define Z(flags, name, op, code) + 1
+enum { BUILTIN_COUNT = 0 PLATFORM_OPCODE_LIST TIER2_OPCODE_LIST
+                         TIER1_OPCODE_LIST TIER0_OPCODE_LIST };
+#undef Z
+#define BUILTIN_SLOTS (BUILTIN_COUNT < 340 ? 512 : BUILTIN_COUNT < 680 ? 1024 : 2048)
+#define BUILTIN_EMPTY 0xffff
+
+static constexpr uint32_t builtin_name_hash(const char *name, uint32_t h) {
+  return *name ? builtin_name_hash(name + 1, h * 33 + UPPER(*name)) : h;
+}
+
+static constexpr uint32_t builtin_key(cell_t vocab, uint32_t hash) {
+  return hash + (uint32_t) vocab * 2654435761u;
+}
+
+static const uint32_t builtin_keys[] = {
+#define Z(flags, name, op, code) \
+  builtin_key(VOC_ ## flags & 0xff, builtin_name_hash(name, 5381)),
+  PLATFORM_OPCODE_LIST
+  TIER2_OPCODE_LIST
+  TIER1_OPCODE_LIST
+  TIER0_OPCODE_LIST
+#undef Z
+};
+
+static uint16_t builtin_slots[BUILTIN_SLOTS];
+
+static void builtin_index(void) {
+  memset(builtin_slots, 0xff, sizeof(builtin_slots));
+  for (int i = 0; i < BUILTIN_COUNT; ++i) {
+    uint32_t slot = builtin_keys[i] % BUILTIN_SLOTS;
+    while (builtin_slots[slot] != BUILTIN_EMPTY) { slot = (slot + 1) % BUILTIN_SLOTS; }
+    builtin_slots[slot] = i;
+  }
+}
+
+static cell_t find_builtin(cell_t vocab, const char *name, cell_t len) {
+  uint32_t slot = builtin_key(vocab, name_hash(name, len)) % BUILTIN_SLOTS;
+  for (; builtin_slots[slot] != BUILTIN_EMPTY; slot = (slot + 1) % BUILTIN_SLOTS) {
+    const BUILTIN_WORD *b = &g_sys->builtins[builtin_slots[slot]];
+    if (b->vocabulary == vocab && len == b->name_length && same(name, b->name, len)) {
+      return (cell_t) &b->code;
+    }
+  }
+  return 0;
+}
+
+static cell_t find_chain(cell_t xt, const char *name, cell_t len, cell_t **next) {
+  while (xt) {
+    if ((*TOFLAGS(xt) & BUILTIN_FORK)) {
+      cell_t found = find_builtin(TOLINK(xt)[3], name, len);
+      if (found) { return found; }
+    }
+    if (!(*TOFLAGS(xt) & SMUDGE) &&
+        len == *TONAMELEN(xt) &&
+        same(name, TONAME(xt), len)) {
+      return xt;
+    }
+    if (next && dict_boundary(xt)) { *next = TOLINK(xt); return 0; }
+    xt = *TOLINK(xt);
+  }
+  if (next) { *next = 0; }
+  return 0;
+}
+
+static cell_t find_wordlist(cell_t *head_cell, const char *name, cell_t len) {
+  uint32_t h = dict_hash(name, len);
+  while (head_cell) {
+    DICT_WORDLIST *wl = (len && !g_dict.disabled) ? dict_wordlist(head_cell, -1) : 0;
+    if (!wl) { return find_chain(*head_cell, name, len, 0); }
+    if (wl->head != *head_cell) { dict_build(wl); }
+    if (wl->linear) {
+      cell_t found = find_chain(wl->head, name, len, &head_cell);
+      if (found) { return found; }
+      continue;
+    }
+    uint16_t index = wl - g_dict.wordlists;
+    cell_t best = 0;
+    uint32_t best_stamp = 0;
+    for (int32_t n = g_dict.buckets[h]; n >= 0; n = g_dict.nodes[n].next) {
+      DICT_NODE *node = &g_dict.nodes[n];
+      if (node->wordlist == index && node->stamp > best_stamp &&
+          !(*TOFLAGS(node->xt) & SMUDGE) &&
+          len == *TONAMELEN(node->xt) &&
+          same(name, TONAME(node->xt), len)) {
+        best = node->xt;
+        best_stamp = node->stamp;
       }
-      xt = *TOLINK(xt);
     }
+    for (cell_t i = wl->nforks - 1; i >= 0 && wl->fork_stamps[i] > best_stamp; --i) {
+      cell_t found = find_builtin(TOLINK(wl->forks[i])[3], name, len);
+      if (found) { return found; }
+    }
+    if (best) { return best; }
+    head_cell = wl->parent;
+  }
+  return 0;
+}
+
+static cell_t find(const char *name, cell_t len) {
+  for (cell_t ***voc = g_sys->context; *voc; ++voc) {
+    cell_t xt = find_wordlist((cell_t *) *voc, name, len);
+    if (xt) { return xt; }
   }
   return 0;
 }
 
+// Called once xt has been linked in as the newest word of the current wordlist.
+static void dict_link(cell_t xt) {
+  DICT_WORDLIST *wl = dict_wordlist((cell_t *) g_sys->current, 0);
+  if (!wl || wl->head != *TOLINK(xt)) { return; }  // Rebuilt on next use.
+  wl->head = xt;
+  ++wl->count;
+  if (wl->linear) {
+    if (wl->count >= DICT_LINEAR) { dict_build(wl); }
+    return;
+  }
+  dict_insert(wl, xt, ++g_dict.stamp);
+  if (wl->linear) { dict_build(wl); }
+}
+
+// Called once xt has been unlinked from whichever wordlist held it.
+static void dict_unlink(cell_t xt) {
+  for (int i = 0; i < DICT_WORDLISTS; ++i) {
+    DICT_WORDLIST *wl = &g_dict.wordlists[i];
+    if (wl->head_cell && wl->head == xt) { wl->head = *wl->head_cell; }
+  }
+  if (!*TONAMELEN(xt)) { return; }
+  int32_t *n = &g_dict.buckets[dict_hash(TONAME(xt), *TONAMELEN(xt))];
+  for (; *n >= 0; n = &g_dict.nodes[*n].next) {
+    DICT_NODE *node = &g_dict.nodes[*n];
+    if (node->xt != xt) { continue; }
+    DICT_WORDLIST *wl = &g_dict.wordlists[node->wordlist];
+    --wl->count;
+    for (cell_t i = 0; i < wl->nforks; ++i) {
+      if (wl->forks[i] != xt) { continue; }
+      --wl->nforks;
+      memmove(&wl->forks[i], &wl->forks[i + 1], (wl->nforks - i) * sizeof(cell_t));
+      memmove(&wl->fork_stamps[i], &wl->fork_stamps[i + 1],
+              (wl->nforks - i) * sizeof(uint32_t));
+      break;
+    }
+    int32_t dead = *n;
+    *n = node->next;
+    node->next = g_dict.free;
+    g_dict.free = dead;
+    return;
+  }
+}
+
+static int dict_grow(cell_t n, cell_t *below) {
+  cell_t size = n + DICT_MARGIN > DICT_SEGMENT_SIZE ? n + DICT_MARGIN : DICT_SEGMENT_SIZE;
+  DICT_SEGMENT *s = (DICT_SEGMENT *) malloc(sizeof(DICT_SEGMENT) + size);
+  if (!s) { return 0; }
+  s->prev = g_sys->segment;
+  s->below = below;
+  s->size = size;
+  g_sys->segment = s;
+  g_sys->heap = segment_start(s);
+  g_sys->heap_limit = segment_limit(s);
+  return 1;
+}
+
+// here can move between segments (locals swap it in and out of
+// locals-area), so take the limit from whichever segment it lands in.
+// Growing within a segment must leave DICT_PAD; 0 if it would not.
+static int dict_allot(cell_t n) {
+  cell_t *to = (cell_t *) ((char *) g_sys->heap + n);
+  if (n > 0 && to <= g_sys->heap_limit &&
+      (char *) to > (char *) g_sys->heap_limit - DICT_PAD) { return 0; }
+  for (DICT_SEGMENT *s = g_sys->segment;; s = s->prev) {
+    if (to >= segment_start(s) && to <= segment_limit(s)) {
+      g_sys->heap_limit = segment_limit(s);
+      break;
+    }
+    if (!s) {
+      if (n > 0) { return 0; }
+      break;
+    }
+  }
+  g_sys->heap = to;
+  return 1;
+}
+
+// Open a new segment now unless n more bytes, after a word header,
+// would leave DICT_PAD free. Defining words that take addresses into
+// the body they are about to allot call this (as room) before create,
+// since a body is never moved once begun.
+static void dict_reserve(cell_t n) {
+  if ((char *) g_sys->heap + n + DICT_MARGIN > (char *) g_sys->heap_limit &&
+      g_sys->heap_limit == segment_limit(g_sys->segment)) {
+    dict_grow(n, g_sys->heap);
+  }
+}
+#define DICT_ROOM(n) \
+  if ((char *) g_sys->heap + (n) > (char *) g_sys->heap_limit - DICT_PAD) { \
+    PUSH -8; goto OP_THROW; }  // dictionary overflow
+
 static void finish(void) {
   if (g_sys->latestxt && !*TOPARAMS(g_sys->latestxt)) {
     cell_t sz = g_sys->heap - &g_sys->latestxt[1];
@@ -1191,6 +2414,7 @@ static void finish(void) {
 
 static void create(const char *name, cell_t nlength, cell_t flags, void *op) {
   finish();
+  dict_reserve(nlength);
   g_sys->heap = (cell_t *) CELL_ALIGNED(g_sys->heap);
   for (cell_t n = nlength; n; --n) { CCOMMA(*name++); }  // name
   g_sys->heap = (cell_t *) CELL_ALIGNED(g_sys->heap);
@@ -1199,29 +2423,151 @@ static void create(const char *name, cell_t nlength, cell_t flags, void *op) {
   *g_sys->current = g_sys->heap;
   g_sys->latestxt = g_sys->heap;
   COMMA(op);  // code
+  dict_link((cell_t) g_sys->latestxt);
 }
 
-static int match(char sep, char ch) {
-  return sep == ch || (sep == ' ' && (ch == '\t' || ch == '\n' || ch == '\r'));
+// Separators for parse(' '), by byte.
+static const char g_blank[256] = {
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 1, 0, 0,  // \t \n \r
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+  1,  // ' '
+};
+
+// Every separator is <= ' ', so a 32-bit word with no byte below 0x21
+// holds none and is stepped over whole.
+static cell_t scan_blank(const unsigned char *tib, cell_t tin, cell_t ntib) {
+  uint32_t w;
+  while (tin < ntib) {
+    if (tin + 4 <= ntib) {
+      memcpy(&w, tib + tin, sizeof(w));
+      if (!((w - 0x21212121u) & ~w & 0x80808080u)) { tin += 4; continue; }
+    }
+    if (g_blank[tib[tin]]) { break; }
+    ++tin;
+  }
+  return tin;
 }
 
 static cell_t parse(cell_t sep, cell_t *ret) {
+  const unsigned char *tib = (const unsigned char *) g_sys->tib;
+  cell_t tin = g_sys->tin, ntib = g_sys->ntib, start;
   if (sep == ' ') {
-    while (g_sys->tin < g_sys->ntib &&
-           match(sep, g_sys->tib[g_sys->tin])) { ++g_sys->tin; }
-  }
-  cell_t start = g_sys->tin;
-  while (g_sys->tin < g_sys->ntib &&
-         !match(sep, g_sys->tib[g_sys->tin])) { ++g_sys->tin; }
-  cell_t len = g_sys->tin - start;
-  if (g_sys->tin < g_sys->ntib) { ++g_sys->tin; }
-  *ret = (cell_t) (g_sys->tib + start);
+    while (tin < ntib && g_blank[tib[tin]]) { ++tin; }
+    start = tin;
+    tin = scan_blank(tib, tin, ntib);
+  } else {
+    start = tin;
+    const void *at = memchr(tib + tin, (char) sep, ntib - tin);
+    tin = at ? (const unsigned char *) at - tib : ntib;
+  }
+  cell_t len = tin - start;
+  if (tin < ntib) { ++tin; }
+  g_sys->tin = tin;
+  *ret = (cell_t) (tib + start);
   return len;
 }
 
+// Peephole superinstructions.
+// g_peep_op is the last op cell compiled by compile() or as a literal by
+// evaluate1. If nothing else was compiled since (heap still at g_peep_end),
+// an op that pairs with it in g_sys->fusions replaces it in place; any
+// inline operands (literal, branch target) stay where they were.
+static cell_t *g_peep_op = 0, *g_peep_end = 0;
+
+// Colon words marked INLINE are spliced into their callers by compile().
+// Only short bodies that leave the return stack alone qualify; anything
+// in g_rstack_ops or g_noinline_ops (set by forth_run) would see the
+// caller's frame.
+#define INLINE_CELLS 8
+static const void *const *g_rstack_ops, *const *g_noinline_ops;
+
+// Whether any of the n cells of body is a word whose code is in ops.
+static int body_uses(const cell_t *body, cell_t n, const void *const *ops) {
+  cell_t lo = (cell_t) g_sys->builtins;
+  cell_t hi = (cell_t) &g_sys->builtins[BUILTIN_COUNT];
+  for (cell_t i = 0; i < n; ++i) {
+    cell_t v = body[i];
+    if ((v & CELL_MASK) || !((v >= lo && v < hi) ||
+        in_dictionary(v))) { continue; }
+    for (const void *const *op = ops; *op; ++op) {
+      if (*(void **) v == *op) { return 1; }
+    }
+  }
+  return 0;
+}
+
+static cell_t inline_body(cell_t xt, cell_t *tail) {
+  cell_t *body = (cell_t *) xt + 1;
+  cell_t n = *TOPARAMS(xt);
+  if (n && body[n - 1] == g_sys->DOEXIT_XT) { *tail = 0; return n - 1; }
+  if (n >= 2 && body[n - 2] == g_sys->TAIL_XT) { *tail = body[n - 1]; return n - 2; }
+  return -1;
+}
+
+static int inline_mark(cell_t xt) {
+  cell_t tail, n;
+  if (!xt || *(void **) xt != g_sys->DOCOL_OP) { return 0; }
+  if ((n = inline_body(xt, &tail)) < 0 || n > INLINE_CELLS) { return 0; }
+  cell_t *body = (cell_t *) xt + 1;
+  if (body_uses(body, n, g_rstack_ops) || body_uses(body, n, g_noinline_ops)) {
+    return 0;
+  }
+  COMMA(g_sys->inlines);
+  COMMA(xt);
+  g_sys->inlines = g_sys->heap - 2;
+  return 1;
+}
+
+static void compile(cell_t xt) {
+  if (g_sys->inlines && *(void **) xt == g_sys->DOCOL_OP) {
+    for (cell_t *i = g_sys->inlines; i; i = (cell_t *) i[0]) {
+      if (i[1] != xt) { continue; }
+      cell_t tail, n = inline_body(xt, &tail);
+      for (cell_t j = 0; j < n; ++j) { COMMA(((cell_t *) xt)[1 + j]); }
+      g_peep_end = 0;
+      if (tail) { compile(tail); }
+      return;
+    }
+  }
+  if (g_peep_end == g_sys->heap) {
+    for (cell_t *f = g_sys->fusions; f; f = (cell_t *) f[0]) {
+      if (f[1] == *g_peep_op && f[2] == xt) { *g_peep_op = f[3]; return; }
+    }
+  }
+  g_peep_op = g_sys->heap;
+  COMMA(xt);
+  g_peep_end = g_sys->heap;
+}
+
+// Whether a tail call to colon word xt behaves as a call: not if its body
+// reaches into the return stack, as r> drop does to exit its caller.
+static int tail_safe(cell_t xt) {
+  cell_t n = xt == (cell_t) g_sys->latestxt ?  // recurse: still compiling
+      g_sys->heap - ((cell_t *) xt + 1) : *TOPARAMS(xt);
+  return n < 0xffff && !body_uses((cell_t *) xt + 1, n, g_rstack_ops);
+}
+
+// Ends a definition. A call to a colon word compiled last (nothing, not
+// even a THEN label, after it) becomes TAIL xt in place of xt EXIT,
+// unless that word works on the return stack (see tail_safe).
+static void compile_exit(void) {
+  if (g_peep_end == g_sys->heap && g_peep_op == g_sys->heap - 1 &&
+      *(void **) *g_peep_op == g_sys->DOCOL_OP && tail_safe(*g_peep_op)) {
+    cell_t xt = *g_peep_op;
+    *g_peep_op = g_sys->TAIL_XT;
+    COMMA(xt);
+  } else {
+    COMMA(g_sys->DOEXIT_XT);
+  }
+  g_peep_end = 0;
+}
+
 static cell_t *evaluate1(cell_t *rp) {
   cell_t call = 0;
-  cell_t tos, *sp, *ip;
+  cell_t tos, *sp, *ip, *hp;
+#ifdef ENABLE_NOS_CACHE
+  cell_t nos;
+#endif
   float *fp;
   UNPARK;
   cell_t name;
@@ -1230,19 +2576,35 @@ static cell_t *evaluate1(cell_t *rp) {
   cell_t xt = find((const char *) name, len);
   if (xt) {
     if (g_sys->state && !(*TOFLAGS(xt) & IMMEDIATE)) {
-      COMMA(xt);
+      compile(xt);
     } else {
+      if (!g_sys->state) { g_peep_end = 0; }
       call = xt;
     }
   } else {
     cell_t n;
+    dcell_t d;
     if (convert((const char *) name, len, g_sys->base, &n)) {
       if (g_sys->state) {
+        g_peep_op = g_sys->heap;
         COMMA(g_sys->DOLIT_XT);
         COMMA(n);
+        g_peep_end = g_sys->heap;
       } else {
         PUSH n;
       }
+    } else if (dconvert((const char *) name, len, g_sys->base, &d)) {
+      if (g_sys->state) {
+        COMMA(g_sys->DOLIT_XT);
+        COMMA((cell_t) d);
+        g_peep_op = g_sys->heap;
+        COMMA(g_sys->DOLIT_XT);
+        COMMA((cell_t) (d >> DCELL_BITS));
+        g_peep_end = g_sys->heap;
+      } else {
+        PUSH (cell_t) d;
+        PUSH (cell_t) (d >> DCELL_BITS);
+      }
     } else {
       float f;
       if (fconvert((const char *) name, len, &f)) {
@@ -1279,7 +2641,9 @@ static void forth_init(int argc, char *argv[],
   memset(g_sys, 0, sizeof(G_SYS));
   g_sys->heap_start = (cell_t *) heap;
   g_sys->heap_size = heap_size;
+  g_sys->heap_limit = segment_limit(0);
   g_sys->stack_cells = STACK_CELLS;
+  dict_reset();
 
   // Start heap after G_SYS area.
   g_sys->heap = g_sys->heap_start + sizeof(G_SYS) / sizeof(cell_t);
@@ -1316,8 +2680,13 @@ static void forth_init(int argc, char *argv[],
   g_sys->DOFLIT_XT = FIND("DOFLIT");
   g_sys->DOEXIT_XT = FIND("EXIT");
   g_sys->YIELD_XT = FIND("YIELD");
+  g_sys->TAIL_XT = FIND("TAIL");
   g_sys->notfound = FIND("DROP");
 
+  // Thread a CATCH frame returns through when its xt completes.
+  g_sys->catch_ip = g_sys->heap;
+  COMMA(FIND("UNCATCH"));
+
   // Init code.
   cell_t *start = g_sys->heap;
   COMMA(FIND("EVALUATE1"));
@@ -1332,12 +2701,21 @@ static void forth_init(int argc, char *argv[],
 
   *++rp = (cell_t) fp;
   *++rp = (cell_t) sp;
+  *++rp = 0;  // no CATCH frame
   *++rp = (cell_t) start;
   g_sys->rp = rp;
   g_sys->runner = forth_run;
 }
-#define JMPW goto **(void **) w
-#define NEXT w = *ip++; JMPW
+#ifdef ENABLE_PROFILER_SUPPORT
+# define JMPW { if (g_profiling) { profile_hit(w); } goto **(void **) w; }
+#else
+# define JMPW goto **(void **) w
+#endif
+#ifdef ENABLE_SAMPLER_SUPPORT
+# define NEXT w = *ip++; g_sample_ip = ip; JMPW
+#else
+# define NEXT w = *ip++; JMPW
+#endif
 #define ADDROF(x) (&& OP_ ## x)
 
 static cell_t *forth_run(cell_t *init_rp) {
@@ -1354,11 +2732,31 @@ static cell_t *forth_run(cell_t *init_rp) {
   };
 
   if (!init_rp) {
+    static const void *const rstack_ops[] = {
+      ADDROF(RPAT), ADDROF(RPSTORE), ADDROF(TOR), ADDROF(FROMR), ADDROF(RAT),
+      ADDROF(rdrop), ADDROF(FROMR2), ADDROF(TWOTOR), ADDROF(TWOFROMR),
+      ADDROF(TWORAT), 0,
+    };
+    static const void *const noinline_ops[] = {
+      ADDROF(EXIT), ADDROF(TAIL), ADDROF(DOES),
+      ADDROF(BRANCH), ADDROF(0BRANCH), ADDROF(DONEXT), ADDROF(EQUAL0BRANCH),
+      ADDROF(LITEQUAL0BRANCH), ADDROF(DOCASE), ADDROF(DODO), ADDROF(DOQDO),
+      ADDROF(DOLOOP), ADDROF(DOPLOOP), ADDROF(DOLEAVE), ADDROF(UNLOOP),
+      ADDROF(J), ADDROF(K), ADDROF(DOLOCALAT), ADDROF(DOLOCALSTORE),
+      ADDROF(DOLOCALPLUSSTORE), 0,
+    };
     g_sys->DOCREATE_OP = ADDROF(DOCREATE);
+    g_sys->DOCOL_OP = ADDROF(DOCOL);
+    g_rstack_ops = rstack_ops;
+    g_noinline_ops = noinline_ops;
     g_sys->builtins = builtins;
+    builtin_index();
     return 0;
   }
-  register cell_t *ip, *rp, *sp, tos, w;
+  register cell_t *ip, *rp, *sp, *hp, tos, w;
+#ifdef ENABLE_NOS_CACHE
+  register cell_t nos;
+#endif
   register float *fp, ft;
   rp = init_rp; UNPARK; NEXT;
 #define Z(flags, name, op, code) OP_ ## op: { code; } NEXT;
@@ -1381,8 +2779,8 @@ fp@ constant fp0
 : fdepth ( -- n ) fp@ fp0 - 4 / ;
 
 ( Useful heap size words )
-: remaining ( -- n ) 'heap-start @ 'heap-size @ + 'heap @ - ;
-: used ( -- n ) 'heap @ sp@ 'stack-cells @ cells + - 28 + ;
+: remaining ( -- n ) 'heap-limit @ 'heap @ - ;
+: used ( -- n ) sp@ cell+ 'stack-cells @ cells + dict-span 28 + ;
 
 ( Quoting Words )
 : ' bl parse 2dup find dup >r -rot r> 0= 'notfound @ execute 2drop ;
@@ -1396,12 +2794,19 @@ create AGAIN ' branch @ ' again !     : again   ['] again , , ; immediate
 create UNTIL ' 0branch @ ' until !    : until   ['] until , , ; immediate
 create AHEAD ' branch @ ' ahead !     : ahead   ['] ahead , here 0 , ; immediate
 create THEN ' nop @ ' then !          : then   ['] then , here swap ! ; immediate
-create IF ' 0branch @ ' if !          : if   ['] if , here 0 , ; immediate
+create IF ' 0branch @ ' if !          : if   ['] if compile, here 0 , ; immediate
 create ELSE ' branch @ ' else !       : else   ['] else , here 0 , swap here swap ! ; immediate
 create WHILE ' 0branch @ ' while !    : while   ['] while , here 0 , swap ; immediate
 create REPEAT ' branch @ ' repeat !   : repeat   ['] repeat , , here swap ! ; immediate
 create AFT ' branch @ ' aft !         : aft   drop ['] aft , here 0 , here swap ; immediate
 
+( Superinstructions fused by compile, )
+create =IF ' =0branch @ ' =if !   create LIT=IF ' lit=0branch @ ' lit=if !
+: fuse ( xt xt xt -- ) here >r 'fusions @ , rot , swap , , r> 'fusions ! ;
+' dolit ' + ' lit+ fuse   ' dolit ' = ' lit= fuse
+' @ ' + ' @+ fuse   ' over ' + ' over+ fuse   ' r> ' r> ' r>r> fuse
+' = ' if >link ' =if fuse   ' lit= ' if >link ' lit=if fuse
+
 ( Recursion )
 : recurse   current @ @ aliteral ['] execute , ; immediate
 
@@ -1422,45 +2827,28 @@ variable leaving
 : leaving(   leaving @ 0 leaving !   2 nest-depth +! ;
 : )leaving   leaving @ swap leaving !  -2 nest-depth +!
              begin dup while dup @ swap here swap ! repeat drop ;
-: DO ( n n -- .. ) swap r> -rot >r >r >r ;
-: do ( lim s -- ) leaving( postpone DO here ; immediate
-: ?DO ( n n -- n n f .. )
-   2dup = if 2drop r> @ >r else swap r> cell+ -rot >r >r >r then ;
-: ?do ( lim s -- ) leaving( postpone ?DO leaving, here ; immediate
-: UNLOOP   r> rdrop rdrop >r ;
-: LEAVE   r> rdrop rdrop @ >r ;
-: leave   postpone LEAVE leaving, ; immediate
-: +LOOP ( n -- ) dup 0< swap r> r> rot + dup r@ < -rot >r >r xor 0=
-                 if r> cell+ rdrop rdrop >r else r> @ >r then ;
-: +loop ( n -- ) postpone +LOOP , )leaving ; immediate
-: LOOP   r> r> 1+ dup r@ < -rot >r >r 0=
-         if r> cell+ rdrop rdrop >r else r> @ >r then ;
-: loop   postpone LOOP , )leaving ; immediate
+create DO ' dodo @ ' do !        : do ( lim s -- ) leaving( postpone DO here ; immediate
+create ?DO ' do?do @ ' ?do !     : ?do ( lim s -- ) leaving( postpone ?DO leaving, here ; immediate
+create LEAVE ' doleave @ ' leave !   : leave   postpone LEAVE leaving, ; immediate
+create +LOOP ' do+loop @ ' +loop !   : +loop ( n -- ) postpone +LOOP , )leaving ; immediate
+create LOOP ' doloop @ ' loop !  : loop   postpone LOOP , )leaving ; immediate
 create I ' r@ @ ' i !  ( i is same as r@ )
-: J ( -- n ) rp@ 3 cells - @ ;
-: K ( -- n ) rp@ 5 cells - @ ;
 
 ( Exceptions )
-variable handler
-: catch ( xt -- n )
-  fp@ >r sp@ >r handler @ >r rp@ handler ! execute
-  r> handler ! rdrop rdrop 0 ;
-: throw ( n -- )
-  dup if handler @ rp! r> handler !
-         r> swap >r sp! drop r> r> fp! else drop then ;
 ' throw 'notfound !
 
 ( Values )
 : value ( n -- ) constant ;
 : value-bind ( xt-val xt )
    >r >body state @ if
-     r@ ['] ! = if rdrop ['] doset , , else aliteral r> , then
+     r@ ['] ! = if rdrop ['] doset , , exit then
+     r@ ['] +! = if rdrop ['] do+set , , exit then
+     aliteral r> ,
    else r> execute then ;
 : to ( n -- ) ' ['] ! value-bind ; immediate
 : +to ( n -- ) ' ['] +! value-bind ; immediate
 
 ( Deferred Words )
-: defer ( "name" -- ) create 0 , does> @ dup 0= throw execute ;
 : is ( xt "name -- ) postpone to ; immediate
 ( Defer I/O to platform specific )
 defer type
@@ -1471,15 +2859,10 @@ defer bye
 : space bl emit ;   : cr 13 emit nl emit ;
 
 ( Numeric Output )
-variable hld
 : pad ( -- a ) here 80 + ;
 : digit ( u -- c ) 9 over < 7 and + 48 + ;
 : extract ( n base -- n c ) u/mod swap digit ;
 : <# ( -- ) pad hld ! ;
-: hold ( c -- ) hld @ 1 - dup hld ! c! ;
-: # ( u -- u ) base @ extract hold ;
-: #s ( u -- 0 ) begin # dup while repeat ;
-: sign ( n -- ) 0< if 45 hold then ;
 : #> ( w -- b u ) drop hld @ pad over - ;
 : str ( n -- b u ) dup >r abs <# #s r> sign #> ;
 : hex ( -- ) 16 base ! ;   : octal ( -- ) 8 base ! ;
@@ -1593,10 +2976,10 @@ forth definitions
 
 ( Make it easy to transfer words between vocabularies )
 : xt-find& ( xt -- xt& ) context @ begin 2dup @ <> while @ >link& repeat nip ;
-: xt-hide ( xt -- ) xt-find& dup @ >link swap ! ;
+: xt-hide ( xt -- ) dup xt-find& dup @ >link swap ! dict-unlink ;
 8 constant BUILTIN_MARK
 : xt-transfer ( xt --  ) dup >flags BUILTIN_MARK and if drop exit then
-  dup xt-hide   current @ @ over >link& !   current @ ! ;
+  dup xt-hide   current @ @ over >link& !   dup current @ !   dict-link ;
 : transfer ( "name" ) ' xt-transfer ;
 : }transfer ;
 : transfer{ begin ' dup ['] }transfer = if drop exit then xt-transfer again ;
@@ -1627,6 +3010,7 @@ transfer{
   tib-setup input-limit sp-limit ?stack
   [SKIP] [SKIP]' raw-ok boot-prompt free.
   $place zplace BUILTIN_MARK
+  fuse =IF LIT=IF
 }transfer
 
 ( Move branching opcodes to separate vocabulary )
@@ -1663,16 +3047,22 @@ forth definitions
 : set-precision ( n -- ) to precision ;
 
 internals definitions
-: #f+s ( r -- ) fdup precision for aft 10e f* then next
-                precision for aft fdup f>s 10 mod [char] 0 + hold 0.1e f* then next
-                [char] . hold fdrop f>s #s ;
+create fbuf 64 allot
 forth definitions internals
 
-: #fs ( r -- ) fdup f0< if fnegate #f+s [char] - hold else #f+s then ;
-: f. ( r -- ) <# #fs #> type space ;
+: f>str ( r -- a n ) precision fbuf fformat fbuf swap ;
+: #fs ( r -- ) f>str begin dup while 1- 2dup + c@ hold repeat nip ;
+: f. ( r -- ) f>str type space ;
 : f.s   ." <" fdepth n. ." > "
         fdepth 0 max for aft fp@ r@ sfloats - sf@ f. then next ;
 
+( Double-cell numbers )
+: d. ( d -- ) dup >r dabs <# d#s drop r> sign #> type space ;
+: ud. ( ud -- ) <# d#s drop #> type space ;
+: 2constant ( d "name" ) create swap , , does> 2@ ;
+: 2variable ( "name" ) create 0 , 0 , ;
+: 2literal ( d -- ) swap aliteral aliteral ; immediate
+
 forth definitions
 ( Vocabulary for building C-style structures )
 
@@ -1702,9 +3092,7 @@ variable last-struct
 
 forth definitions
 ( Words with OS assist )
-: allocate ( n -- a ior ) malloc dup 0= ;
-: free ( a -- ior ) sysfree 0 ;
-: resize ( a n -- a ior ) realloc dup 0= ;
+( allocate, free and resize follow the tasks, to use their arenas )
 
 ( Migrate various words to separate vocabularies, and constants )
 
@@ -1781,6 +3169,18 @@ vocabulary Serial   Serial definitions
 transfer Serial-builtins
 forth definitions
 
+DEFINED? mmap [IF]
+vocabulary posix   posix definitions
+transfer posix-builtins
+forth definitions
+[THEN]
+
+DEFINED? i32fill [IF]
+vocabulary arrays   arrays definitions
+transfer arrays-builtins
+forth definitions
+[THEN]
+
 vocabulary sockets   sockets definitions
 transfer sockets-builtins
 1 constant SOCK_STREAM
@@ -1795,7 +3195,11 @@ transfer sockets-builtins
 : bs, ( n -- ) dup 8 rshift c, c, ;
 : s, ( n -- ) dup c, 8 rshift c, ;
 : l, ( n -- ) dup s, 16 rshift s, ;
+DEFINED? posix [IF]
+: sockaddr   create AF_INET s, 0 bs, 0 l, 0 l, 0 l, ;
+[ELSE]
 : sockaddr   create 16 c, AF_INET c, 0 bs, 0 l, 0 l, 0 l, ;
+[THEN]
 : ->port@ ( a -- n ) 2 + >r r@ c@ 8 lshift r> 1+ c@ + ;
 : ->port! ( n a --  ) 2 + >r dup 8 rshift r@ c! r> 1+ c! ;
 : ->addr@ ( a -- n ) 4 + ul@ ;
@@ -1822,8 +3226,8 @@ DEFINED? gpio_config [IF]
 3 constant #GPIO_INTR_ANYEDGE
 4 constant #GPIO_INTR_LOW_LEVEL
 5 constant #GPIO_INTR_HIGH_LEVEL
+: isr-service ( -- ) ESP_INTR_FLAG_DEFAULT gpio_install_isr_service drop ;
 ( Easy word to trigger on any change to a pin )
-ESP_INTR_FLAG_DEFAULT gpio_install_isr_service drop
 : pinchange ( xt pin ) dup #GPIO_INTR_ANYEDGE gpio_set_intr_type throw
                        swap 0 gpio_isr_handler_add throw ;
 [THEN]
@@ -1904,7 +3308,8 @@ cell 1- constant cell-mask
 
 ( Semi-dangerous word to trim down the system heap )
 DEFINED? realloc [IF]
-: relinquish ( n -- ) negate 'heap-size +! 'heap-start @ 'heap-size @ realloc drop ;
+: relinquish ( n -- ) negate 'heap-size +! 'heap-start @ 'heap-size @ realloc drop
+   segments 0= if 'heap-start @ 'heap-size @ + 'heap-limit ! then ;
 [THEN]
 
 forth definitions internals
@@ -1918,7 +3323,7 @@ forth definitions internals
    then next drop cr ;
 
 ( Remove from Dictionary )
-: forget ( "name" ) ' dup >link current @ !  >name drop here - allot ;
+: forget ( "name" ) ' dup >link current @ !  >name drop here - allot  dict-reset ;
 
 internals definitions
 1 constant IMMEDIATE_MARK
@@ -1928,13 +3333,9 @@ internals definitions
 32 constant +TAB
 64 constant -TAB
 128 constant ARGS_MARK
-: mem= ( a a n -- f)
-   for aft 2dup c@ swap c@ <> if 2drop rdrop 0 exit then 1+ swap 1+ then next 2drop -1 ;
 forth definitions also internals
 : :noname ( -- xt ) 0 , current @ @ , NONAMED SMUDGE or ,
-                    here dup current @ ! ['] mem= @ , postpone ] ;
-: str= ( a n a n -- f) >r swap r@ <> if rdrop 2drop 0 exit then r> mem= ;
-: startswith? ( a n a n -- f ) >r swap r@ < if rdrop 2drop 0 exit then r> mem= ;
+                    here dup current @ ! dup dict-link docol , postpone ] ;
 : .s   ." <" depth n. ." > " raw.s cr ;
 only forth definitions
 
@@ -1948,6 +3349,8 @@ internals internalized definitions
 +TAB flags'or! AHEAD
 -TAB flags'or! THEN
 +TAB flags'or! IF
++TAB flags'or! =IF
++TAB flags'or! LIT=IF
 +TAB -TAB or flags'or! ELSE
 +TAB -TAB or flags'or! WHILE
 -TAB flags'or! REPEAT
@@ -1971,7 +3374,13 @@ variable indent
 : see-one ( xt -- xt+1 )
    dup cell+ swap @
    dup ['] DOLIT = if drop dup @ . cell+ exit then
+   dup ['] LIT+ = over ['] LIT= = or if over @ . see. cell+ exit then
+   dup ['] LIT=IF = if over @ . swap cell+ swap then
    dup ['] DOSET = if drop ." TO " dup @ cell - see. cell+ icr exit then
+   dup ['] TAIL = if see. dup @ see. cell+ exit then
+   dup ['] DO+SET = if drop ." +TO " dup @ cell - see. cell+ icr exit then
+   dup ['] DOLOCAL@ = over ['] DOLOCAL! = or over ['] DOLOCAL+! = or
+       if over @ . see. cell+ exit then
    dup ['] DOFLIT = if drop dup sf@ <# [char] e hold #fs #> type space cell+ exit then
    dup ['] $@ = if drop ['] s" see.
                    dup @ dup >r >r dup cell+ r> type cell+ r> 1+ aligned +
@@ -1988,14 +3397,20 @@ variable indent
    dup ['] +! = if icr then
    dup  @ ['] BRANCH @ =
    over @ ['] 0BRANCH @ = or
+   over @ ['] =0BRANCH @ = or
+   over @ ['] LIT=0BRANCH @ = or
    over @ ['] DONEXT @ = or
+   over @ ['] DOCASE @ = or
    over >flags ARGS_MARK and or
        if swap cell+ swap then
    drop
 ;
 : see-loop   dup >body swap >params 1- cells over +
              begin 2dup < while swap see-one swap repeat 2drop ;
-: ?see-flags   >flags IMMEDIATE_MARK and if ." IMMEDIATE " then ;
+: inline? ( xt -- f ) 'inlines @ begin dup while
+                         2dup cell+ @ = if 2drop -1 exit then @ repeat 2drop 0 ;
+: ?see-flags   dup >flags IMMEDIATE_MARK and if ." IMMEDIATE " then
+               inline? if ." INLINE " then ;
 : see-xt ( xt -- )
   dup @ ['] see-loop @ = if
     ['] : see.  dup see.
@@ -2008,6 +3423,7 @@ variable indent
   dup >flags BUILTIN_FORK and if ." Built-in-fork: " see. exit then
   dup @ ['] input-buffer @ = if ." CREATE/VARIABLE: " see. cr exit then
   dup @ ['] SMUDGE @ = if ." DOES>/CONSTANT: " see. cr exit then
+  dup @ ['] type @ = if ." DEFER: " see. cr exit then
   dup @ ['] callcode @ = if ." Code: " see. cr exit then
   dup >params 0= if ." Built-in: " see. cr exit then
   ." Unsupported: " see. cr ;
@@ -2135,19 +3551,15 @@ create locals-area locals-capacity allot
 variable locals-here  locals-area locals-here !
 : <>locals   locals-here @ here locals-here ! here - allot ;
 
-: local@ ( n -- ) rp@ + @ ;
-: local! ( n -- ) rp@ + ! ;
-: local+! ( n -- ) rp@ + +! ;
-
 variable scope-depth
-variable local-op   ' local@ local-op !
+variable local-op   ' dolocal@ local-op !
 : scope-exit   scope-depth @ for aft postpone rdrop then next ;
 : scope-clear
    scope-exit
    scope-depth @ negate nest-depth +!
    0 scope-depth !   0 scope !   locals-area locals-here ! ;
-: do-local ( n -- ) nest-depth @ + cells negate aliteral
-                    local-op @ ,  ['] local@ local-op ! ;
+: do-local ( n -- ) nest-depth @ + 1- cells negate
+                    local-op @ , ,  ['] dolocal@ local-op ! ;
 : scope-create ( a n -- )
    dup >r $place align ( name )
    scope @ , r> 8 lshift 1 or , ( IMMEDIATE ) here scope ! ( link, flags&length )
@@ -2161,8 +3573,8 @@ variable local-op   ' local@ local-op !
 
 : }? ( a n -- ) 1 <> if drop 0 exit then c@ [char] } = ;
 : --? ( a n -- ) s" --" str= ;
-: (to) ( xt -- ) ['] local! local-op ! execute ;
-: (+to) ( xt -- ) ['] local+! local-op ! execute ;
+: (to) ( xt -- ) ['] dolocal! local-op ! execute ;
+: (+to) ( xt -- ) ['] dolocal+! local-op ! execute ;
 
 also forth definitions
 
@@ -2183,13 +3595,47 @@ also forth definitions
 only forth definitions
 internals definitions
 variable cases
+( Literal selectors are recorded as selector/body pairs while the OF
+  chain compiles, ENDCASE then points DOCASE at a jump table if dense. )
+64 constant case-max
+create case-arms case-max 2* cells allot
+variable case-arms#   variable case-base   variable case-op
+variable case-arm   variable case-dense   variable case-at
+256 constant case-capacity
+case-capacity cells room   create case-tables case-capacity cells allot
+variable case-tables#
+: case-literal? ( -- f ) case-arm @ @ ['] dolit = here case-arm @ 2 cells + = and ;
+: case-arm, ( n a -- )
+   case-arms# @ case-max < 0= if 2drop 0 case-dense ! exit then
+   case-arms# @ 2* cells case-arms + >r r@ cell+ ! r> ! 1 case-arms# +! ;
+: case-arm@ ( i -- n a ) 2* cells case-arms + dup @ swap cell+ @ ;
+: case-bounds ( -- lo hi ) case-base @ case-arm@ drop dup
+   case-arms# @ case-base @ ?do i case-arm@ drop dup >r max swap r> min swap loop ;
+: case-table ( -- )
+   case-arms# @ case-base @ - dup 4 < case-dense @ 0= or if drop exit then
+   >r case-bounds over - 1+ ( lo range )
+   dup r> 2* > if 2drop exit then
+   dup 3 + case-tables# @ + case-capacity > if 2drop exit then
+   case-tables# @ cells case-tables + case-at !   dup 3 + case-tables# +!
+   case-at @ 3 cells + over cells erase
+   case-at @ cell+ !   dup case-at @ !   case-arm @ case-at @ 2 cells + !
+   case-arms# @ case-base @ - for aft
+     r@ case-base @ + case-arm@ >r over - 3 + cells case-at @ + r> swap !
+   then next drop
+   case-at @ case-op @ ! ;
 forth definitions internals
 
-: CASE ( n -- ) cases @  0 cases ! ; immediate
-: ENDCASE   postpone drop cases @ for aft postpone then then next
-            cases ! ; immediate
-: OF ( n -- ) postpone over postpone = postpone if postpone drop ; immediate
-: ENDOF   1 cases +! postpone else ; immediate
+: CASE ( -- sys ) cases @ case-base @ case-op @ case-dense @ case-arm @
+   0 cases !   case-arms# @ case-base !   -1 case-dense !
+   ['] docase , here case-op ! 0 ,   here case-arm ! ; immediate
+: ENDCASE   postpone drop case-table
+            cases @ for aft postpone then then next
+            case-base @ case-arms# !
+            case-arm ! case-dense ! case-op ! case-base ! cases ! ; immediate
+: OF ( n -- ) case-literal? >r case-arm @ cell+ @ >r
+   postpone over postpone = postpone if postpone drop
+   r> r> if here case-arm, else drop 0 case-dense ! then ; immediate
+: ENDOF   1 cases +! postpone else   here case-arm ! ; immediate
 
 forth definitions
 ( Cooperative Tasks )
@@ -2197,6 +3643,7 @@ forth definitions
 vocabulary tasks   tasks definitions also internals
 
 variable task-list
+variable all-tasks  ( started or not, newest first )
 
 : .tasks   task-list @ begin dup 2 cells - see. @ dup task-list @ = until drop ;
 
@@ -2209,7 +3656,9 @@ forth definitions tasks also internals
 ;
 
 : task ( xt dsz rsz "name" )
-   create here >r 0 , 0 , ( link, sp )
+   2dup + 9 + cells room
+   create here >r 0 , 0 , 0 , all-tasks @ , ( link, sp, arena, next )
+   r@ all-tasks !
    swap here cell+ r@ cell+ ! cells allot
    here r@ cell+ @ ! cells allot
    dup 0= if drop else
@@ -2233,14 +3682,45 @@ DEFINED? ms-ticks [IF]
 
 tasks definitions
 0 0 0 task main-task   main-task start-task
+
+( Each task allocates from its own arena, or with malloc while it is 0 )
+forth definitions tasks also internals
+: arena@ ( -- arena ) task-list @ 2 cells + @ ;
+: arena! ( arena -- ) task-list @ 2 cells + ! ;
+: task-arena! ( arena t -- ) 2 cells + ! ;
+: arena-new ( n -- arena ) arena-create dup 0= throw ;
+: arena-delete ( arena -- ) all-tasks @ begin dup while
+     2dup 2 cells + @ = if 0 over task-arena! then 3 cells + @ repeat
+   drop arena-delete ;
+: allocate ( n -- a ior ) arena@ arena-allocate dup 0= ;
+: free ( a -- ior ) arena-free 0 ;
+: resize ( a n -- a ior ) arena@ arena-resize dup 0= ;
+
+( Allocation by kind of memory, each freed with free )
+: allocate-psram ( n -- a ior )
+   [ MALLOC_CAP_SPIRAM MALLOC_CAP_8BIT or ] literal heap-allocate dup 0= ;
+: allocate-dma ( n -- a ior )
+   [ MALLOC_CAP_DMA MALLOC_CAP_8BIT or ] literal heap-allocate dup 0= ;
+: allocate-iram ( n -- a ior )
+   [ MALLOC_CAP_INTERNAL MALLOC_CAP_8BIT or ] literal heap-allocate dup 0= ;
+
+( Buffers made by stream, place-blocks and the editor use placement: )
+( heap capabilities, or 0 for the dictionary or allocate )
+0 value placement
+: placed ( n -- a ) placement if placement heap-allocate
+   else arena@ arena-allocate then dup 0= throw ;
+: placed-resize ( a n -- a ) placement if placement heap-resize
+   else arena@ arena-resize then dup 0= throw ;
 only forth definitions
 ( Byte Stream / Ring Buffer )
 
 vocabulary streams   streams definitions
 
-: stream ( n "name" ) create 1+ dup , 0 , 0 , allot align ;
+: stream ( n "name" ) placement 0= if dup 6 cells + room then
+   create 1+ dup , 0 , 0 ,
+   placement if placed , else here cell+ , allot align then ;
 : >write ( st -- wr ) cell+ ;   : >read ( st -- rd ) 2 cells + ;
-: >offset ( n st -- a ) 3 cells + + ;
+: >offset ( n st -- a ) 3 cells + @ + ;
 : stream# ( sz -- n ) >r r@ >write @ r@ >read @ - r> @ mod ;
 : full? ( st -- f ) dup stream# swap @ 1- = ;
 : empty? ( st -- f ) stream# 0= ;
@@ -2324,6 +3804,7 @@ internals definitions
 ' forth >body constant forth-wordlist
 
 : save-name
+  segments 0= assert  ( an image holds only the first segment )
   'heap @ park-heap !
   forth-wordlist @ park-forth !
   w/o create-file throw >r
@@ -2336,6 +3817,7 @@ internals definitions
   r> close-file throw
   park-heap @ 'heap !
   park-forth @ forth-wordlist !
+  dict-reset
   'cold @ dup if execute else drop then ;
 
 defer remember-filename
@@ -2350,6 +3832,104 @@ forth definitions also internals
 : startup: ( "name" ) ' 'cold ! remember ;
 : revive   remember-filename restore-name ;
 : reset   remember-filename delete-file throw ;
+DEFINED? boot-image-path [IF]
+: boot-image   boot-image-path w/o create-file throw close-file throw ;
+: no-boot-image   boot-image-path delete-file throw ;
+[THEN]
+DEFINED? xip-region [IF]
+: frozen? ( xt -- f ) xip-region >r - 0 r> 0 du< ;
+: forget ( "name" ) ' dup frozen? 0= assert
+   dup >link current @ !  >name drop here - allot  dict-reset ;
+( Links in flash are read-only, so frozen words stay where they are )
+internals definitions
+: xt-hide ( xt -- ) dup xt-find& frozen? 0= assert xt-hide ;
+: xt-transfer ( xt -- ) dup >flags BUILTIN_MARK and 0= if
+    dup frozen? 0= assert dup xt-find& frozen? 0= assert then xt-transfer ;
+forth definitions internals
+: transfer ( "name" ) ' xt-transfer ;
+: transfer{ begin ' dup ['] }transfer = if drop exit then xt-transfer again ;
+[THEN]
+DEFINED? profile-on [IF]
+internals definitions
+: .profile-by ( n col -- ) profile-sorted rot min 0 ?do
+    dup @ see. dup cell+ @ n. space dup 2 cells + @ n. cr 3 cells + loop drop ;
+forth definitions internals
+: .profile ( n -- ) ." by calls: name calls ticks" cr dup 1 .profile-by
+                    ." by time: name calls ticks" cr 2 .profile-by ;
+[THEN]
+internals definitions
+variable owner-ip   variable owner-best
+: owner-scan ( xt -- ) begin dup nonvoc? while
+    dup owner-ip @ <= over owner-best @ > and if dup owner-best ! then
+    >link repeat drop ;
+: ip>xt ( ip -- xt ) owner-ip ! 0 owner-best !
+    last-vocabulary @ begin dup while dup >body @ owner-scan >vocnext repeat
+    drop owner-best @ ;
+forth definitions
+DEFINED? 'samples [IF]
+internals definitions
+256 constant sample-kinds-max
+sample-kinds-max 2* cells room
+create sample-tally sample-kinds-max 2* cells allot   variable sample-kinds
+: sample-tally! ( xt -- )
+    sample-kinds @ 0 ?do
+      sample-tally i 2* cells + 2dup @ = if nip cell+ 1 swap +! unloop exit then drop
+    loop
+    sample-kinds @ sample-kinds-max < if
+      sample-tally sample-kinds @ 2* cells + swap over ! cell+ 1 swap ! 1 sample-kinds +!
+    else drop then ;
+: sample-max ( -- a ) sample-tally sample-kinds @ 0 ?do
+    sample-tally i 2* cells + 2dup cell+ @ swap cell+ @ > if nip else drop then
+    loop ;
+forth definitions internals
+: .samples ( n -- )
+    sample-tally sample-kinds-max 2* cells erase 0 sample-kinds !
+    'samples dup n. ."  samples" cr 0 ?do dup i cells + @ ip>xt sample-tally! loop drop
+    0 ?do sample-max dup cell+ @ 0= if drop leave then
+      dup cell+ @ n. space dup @ see. cr 0 swap cell+ ! loop ;
+[THEN]
+internals definitions
+12 constant heap-classes   4 cells constant heap-site#   10 value heap-top
+: heap-stat ( n -- n ) cells 'heap-stats + @ ;
+: heap-class ( n -- allocs live )
+    7 + cells 'heap-stats + dup @ swap heap-classes cells + @ ;
+: heap-class. ( n -- ) dup heap-classes 1- = if
+    drop ." > " heap-classes 2 - else ." <= " then 16 swap lshift n. ;
+: heap-site ( a -- live blocks allocs ) cell+ dup @ swap cell+ dup @ swap cell+ @ ;
+: heap-owner ( a -- a n ) @ ?dup 0= if s" (other)" exit then
+    ip>xt ?dup if >name else s" ?" then ;
+: json" ( a n -- ) [char] " emit 0 ?do dup i + c@
+    dup [char] " = over [char] \ = or if [char] \ emit then emit loop
+    drop [char] " emit ;
+: json: ( n a n -- ) json" [char] : emit n. ;
+: json, [char] , emit ;
+forth definitions internals
+: .heap-report ( -- )
+    ." heap: " 0 heap-stat n. ."  live  " 1 heap-stat n. ."  peak  "
+    2 heap-stat n. ."  allocs  " 3 heap-stat n. ."  frees  "
+    4 heap-stat n. ."  dropped  " 5 heap-stat n. ."  strays" cr
+    heap-classes 0 do i heap-class over if
+      2 spaces i heap-class. ." : " swap n. ."  allocs " n. ."  live" cr
+    else 2drop then loop
+    ." live blocks allocs word" cr
+    heap-sites heap-top min 0 ?do
+      dup heap-site rot n. space swap n. space n. space dup heap-owner type cr
+    heap-site# + loop drop ;
+: .heap-json ( -- )
+    [char] { emit 0 heap-stat s" live" json: json, 1 heap-stat s" peak" json: json,
+    2 heap-stat s" allocs" json: json, 3 heap-stat s" frees" json: json,
+    4 heap-stat s" dropped" json: json, 5 heap-stat s" strays" json: json,
+    s" classes" json" ." :["
+    heap-classes 0 do i if json, then [char] { emit
+      s" max" json" [char] : emit i heap-classes 1- = if ." null" else 16 i lshift n. then
+      json, i heap-class swap s" allocs" json: json, s" live" json: [char] } emit
+    loop ." ]," s" sites" json" ." :["
+    heap-sites 0 ?do i if json, then [char] { emit
+      s" word" json" [char] : emit dup heap-owner json" json,
+      dup heap-site rot s" live" json: json, swap s" blocks" json: json,
+      s" allocs" json: [char] } emit
+    heap-site# + loop drop ." ]}" ;
+only forth definitions
 
 only forth definitions
 ( Including Files )
@@ -2444,7 +4024,8 @@ internals definitions
 : clobber-line ( a -- a' ) dup 63 blank 63 + nl over c! 1+ ;
 : clobber ( a -- ) 15 for clobber-line next drop ;
 0 value block-dirty
-create block-data 1024 allot
+create block-buffer 1024 allot
+block-buffer value block-data
 forth definitions internals
 
 -1 value block-fid   variable scr   -1 value block-id
@@ -2477,6 +4058,8 @@ forth definitions internals
 : empty-buffers   -1 to block-id ;
 : update   -1 to block-dirty ;
 : flush   save-buffers empty-buffers ;
+: place-blocks ( -- ) flush block-data block-buffer <> if block-data free throw then
+   placement if 1024 placed else block-buffer then to block-data ;
 
 ( Loading )
 : load ( n -- ) block 1024 evaluate ;
@@ -2536,7 +4119,7 @@ create filename max-path allot 0 value filename#
 0 value fileh
 
 10 constant start-size
-start-size allocate throw value text
+start-size placed value text
 start-size value capacity
 0 value length
 0 value caret
@@ -2561,7 +4144,7 @@ start-size value capacity
 ;
 
 : insert ( ch -- )
-  length capacity = if text capacity 1+ 2* >r r@ 1+ resize throw to text r> to capacity then
+  length capacity = if text capacity 1+ 2* >r r@ 1+ placed-resize to text r> to capacity then
   text caret + dup 1+ length caret - cmove>
   text caret + c!
   1 +to caret
@@ -2607,7 +4190,7 @@ start-size value capacity
      filename filename# r/o open-file 0= if
          to fileh
          fileh file-size throw to capacity
-         text capacity 1+ resize throw to text
+         text capacity 1+ placed-resize to text
          capacity to length
          text length fileh read-file throw drop
          fileh close-file throw
@@ -2709,13 +4292,17 @@ also ledc also serial also SPIFFS
 2 constant OUTPUT
 2 constant LED
 
-( Startup Setup )
+( Startup Setup, run after boot-checkpoint )
 -1 echo !
-115200 Serial.begin
-100 ms
--1 z" /spiffs" 10 SPIFFS.begin drop
-led OUTPUT pinMode
-high led pin
+also interrupts also internals definitions
+: boot-devices
+  115200 Serial.begin
+  100 ms
+  -1 z" /spiffs" 10 SPIFFS.begin drop
+  led OUTPUT pinMode
+  high led pin
+  [ DEFINED? isr-service ] literal ?dup if execute then ;
+previous previous
 
 internals definitions also ESP
 : esp32-stats
@@ -3281,7 +4868,7 @@ also internals
 
 1 constant max-connections
 2048 constant chunk-size
-create chunk chunk-size allot
+chunk-size room   create chunk chunk-size allot
 0 value chunk-filled
 256 constant body-chunk-size
 create body-chunk body-chunk-size allot
@@ -3305,17 +4892,6 @@ sockaddr httpd-port   sockaddr client   variable client-len
   sockfd max-connections listen throw
 ;
 
-: upper ( ch -- ch )
-  dup [char] a >= over [char] z <= and if 95 and then ;
-: strcase= ( a n a n -- f )
-  >r swap r@ <> if rdrop 2drop 0 exit then r>
-  for aft
-    2dup c@ upper swap c@ upper <> if 2drop 0 exit then
-    1+ swap 1+ swap
-  then next
-  2drop -1
-;
-
 variable goal   variable goal#
 : end< ( n -- f ) chunk-filled < ;
 : in@<> ( n ch -- f ) >r chunk + c@ r> <> ;
@@ -3392,6 +4968,10 @@ variable goal   variable goal#
 : ok-response ( mime$ -- ) s" OK" 200 response ;
 : bad-response ( -- ) s" text/plain" s" Bad Request" 400 response ;
 : notfound-response ( -- ) s" text/plain" s" Not Found" 404 response ;
+: heap-response ( -- )
+  s" application/json" ok-response
+  ['] type >body @ >r ['] client-type is type
+  ['] .heap-json catch r> is type throw ;
 
 only forth definitions
 httpd
@@ -3500,7 +5080,7 @@ variable webserver
 2000 constant out-size
 200 stream input-stream
 out-size stream output-stream
-create out-string out-size 1+ allot align
+out-size 1+ room   create out-string out-size 1+ allot align
 
 : handle-index
    s" text/html" ok-response
@@ -3521,6 +5101,7 @@ create out-string out-size 1+ allot align
   handleClient if
     s" /" path str= if handle-index exit then
     s" /input" path str= if handle-input exit then
+    s" /heap" path str= if heap-response exit then
     notfound-response
   then
 ;
@@ -3633,6 +5214,13 @@ $3ff5f000 constant TIMG_BASE
                          1 swap enable! ;
 : rerun ( t -- ) 1 swap alarm-enable! ;
 
+DEFINED? sample [IF]
+variable sample-timer
+: sample-tick ( n -- ) drop sample sample-timer @ rerun ;
+: sample-start ( usec t -- ) dup sample-timer ! ['] sample-tick -rot interval ;
+: sample-stop ( -- ) 0 sample-timer @ enable! ;
+[THEN]
+
 only forth definitions
 timers
 | evaluate ;
@@ -3726,6 +5314,9 @@ transfer camera-builtins
 6 constant PIXFORMAT_RGB444
 7 constant PIXFORMAT_RGB555
 
+0 constant CAMERA_FB_IN_PSRAM
+1 constant CAMERA_FB_IN_DRAM
+
 0 constant FRAMESIZE_96x96    ( 96x96)
 1 constant FRAMESIZE_QQVGA    ( 160x120 )
 2 constant FRAMESIZE_QCIF     ( 176x144 )
@@ -3743,7 +5334,7 @@ transfer camera-builtins
 
 ( See https://github.com/espressif/esp32-camera/blob/master/driver/include/esp_camera.h )
 ( Settings for AI_THINKER )
-create camera-config
+32 cells room   create camera-config
   32 , ( pin_pwdn ) -1 , ( pin_reset ) 0 , ( pin_xclk )
   26 , ( pin_sscb_sda ) 27 , ( pin_sscb_scl )
   35 , 34 , 39 , 36 , 21 , 19 , 18 , 5 , ( pin_d7 - pin_d0 )
@@ -3758,6 +5349,10 @@ create camera-config
   12 , ( jpeg_quality 0-63 low good )
   here
   1 , ( fb_count )
+  here
+  CAMERA_FB_IN_PSRAM , ( fb_location )
+  0 , ( grab_mode )
+constant camera-fb-location
 constant camera-fb-count
 constant camera-jpeg-quality
 constant camera-frame-size
@@ -3775,6 +5370,12 @@ field@ fb->sec
 field@ fb->usec
 drop
 
+( Copy out the next frame, into a buffer per placement, and free with free )
+: frame-copy ( -- a n )
+  esp_camera_fb_get dup 0= throw { fb }
+  fb fb->len placed fb fb->buf over fb fb->len cmove
+  fb fb->len fb esp_camera_fb_return ;
+
 5 cells
 field@ s->xclk_freq_hz ( a )
 field@ s->init_status ( s )
@@ -3919,6 +5520,9 @@ forth definitions internals
 transfer forth
 ( Move heap to save point, with a gap. )
 setup-saving-base
+( A prebuilt boot image resumes from here. )
+boot-checkpoint
+boot-devices
 forth
 execute ( assumes an xt for autoboot is on the dstack )
 ok
@@ -3973,8 +5577,15 @@ static void IRAM_ATTR HandleInterrupt(void *arg) {
   cell_t *rp = rstack;
   *++rp = (cell_t) (fstack + 1);
   *++rp = (cell_t) (stack + 1);
+  *++rp = 0;  // no CATCH frame
   *++rp = (cell_t) code;
+#ifdef ENABLE_SAMPLER_SUPPORT
+  g_sample_isr_ip = g_sample_ip;
+  forth_run(rp);
+  g_sample_ip = g_sample_isr_ip;
+#else
   forth_run(rp);
+#endif
 }
 
 static cell_t EspIntrAlloc(cell_t source, cell_t flags, cell_t xt, cell_t arg, void *ret) {
@@ -4001,13 +5612,530 @@ static cell_t TimerIsrRegister(cell_t group, cell_t timer, cell_t xt, cell_t arg
   return timer_isr_register((timer_group_t) group, (timer_idx_t) timer, HandleInterrupt, args, flags, (timer_isr_handle_t *) ret);
 }
 #endif
+#ifdef ENABLE_PROFILER_SUPPORT
+// Instrumented dispatch.
+// Each xt jumped to counts a call and is charged the ticks until the next
+// dispatch, so a colon word only accrues its own DOCOL (self time).
+#define PROFILE_SLOTS 1024
+#ifdef ESP_PLATFORM
+# define PROFILE_TICKS() ((cell_t) ESP.getCycleCount())
+#else
+# include <time.h>
+static cell_t PROFILE_TICKS(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec * 1000000000 + t.tv_nsec;
+}
+#endif
+
+typedef struct {
+  cell_t xt, calls, ticks;
+} PROFILE_ENTRY;
+
+static PROFILE_ENTRY g_profile[PROFILE_SLOTS], g_profile_sorted[PROFILE_SLOTS];
+static PROFILE_ENTRY *g_profile_last;
+static cell_t g_profile_stamp, g_profile_column;
+
+static PROFILE_ENTRY *profile_slot(cell_t xt) {
+  ucell_t i = ((ucell_t) xt / sizeof(cell_t)) % PROFILE_SLOTS;
+  for (int n = 0; n < PROFILE_SLOTS; ++n) {
+    PROFILE_ENTRY *e = &g_profile[i];
+    if (e->xt == xt) { return e; }
+    if (!e->xt) { e->xt = xt; return e; }
+    i = (i + 1) % PROFILE_SLOTS;
+  }
+  return 0;  // Table full, drop it.
+}
+
+static void profile_hit(cell_t xt) {
+  if (g_profile_last) {
+    g_profile_last->ticks += PROFILE_TICKS() - g_profile_stamp;
+  }
+  g_profile_last = xt ? profile_slot(xt) : 0;
+  if (g_profile_last) { ++g_profile_last->calls; }
+  g_profile_stamp = PROFILE_TICKS();  // Leave out our own bookkeeping.
+}
+
+static void profile_reset(void) {
+  memset(g_profile, 0, sizeof(g_profile));
+  g_profile_last = 0;
+}
+
+static int profile_compare(const void *a, const void *b) {
+  cell_t x = ((const cell_t *) a)[g_profile_column];
+  cell_t y = ((const cell_t *) b)[g_profile_column];
+  return x < y ? 1 : x > y ? -1 : 0;
+}
+
+// Copies the used entries, largest first by column (1 = calls, 2 = ticks).
+static cell_t profile_sort(cell_t column, cell_t *ret) {
+  cell_t n = 0;
+  for (int i = 0; i < PROFILE_SLOTS; ++i) {
+    if (g_profile[i].xt) { g_profile_sorted[n++] = g_profile[i]; }
+  }
+  g_profile_column = column;
+  qsort(g_profile_sorted, n, sizeof(PROFILE_ENTRY), profile_compare);
+  *ret = (cell_t) g_profile_sorted;
+  return n;
+}
+#endif
+#ifdef ENABLE_SAMPLER_SUPPORT
+// Sampling profiler.
+// NEXT publishes ip; a timer records it into a ring of the latest
+// SAMPLE_SLOTS samples. On the board the timer runs a Forth handler
+// (see sample-start in timers), so HandleInterrupt keeps the interrupted
+// ip in g_sample_isr_ip. Elsewhere SIGPROF records it directly.
+static void sample_record(cell_t *ip) {
+  g_samples[g_sample_count % SAMPLE_SLOTS] = ip;
+  g_sample_count = g_sample_count + 1;
+}
+
+#ifndef ESP_PLATFORM
+#include <signal.h>
+#include <sys/time.h>
+
+static void sample_signal(int) {
+  sample_record(g_sample_ip);
+}
+
+static void sample_start(cell_t usec) {
+  struct itimerval t;
+  t.it_interval.tv_sec = t.it_value.tv_sec = usec / 1000000;
+  t.it_interval.tv_usec = t.it_value.tv_usec = usec % 1000000;
+  signal(SIGPROF, sample_signal);
+  setitimer(ITIMER_PROF, &t, 0);
+}
+#endif
+#endif
+#ifdef ENABLE_BOOT_IMAGE_SUPPORT
+// Prebuilt boot image.
+// Interpreting boot[] dominates cold start, so the heap is captured at
+// boot-checkpoint and later installed with a copy plus fixups.
+// Fixups are found by booting twice, BOOT_IMAGE_SHIFT cells apart:
+// a cell that moved by exactly the shift points into the heap.
+// Everything else must match, so the image is tied to one firmware.
+#define BOOT_IMAGE_MAGIC 0x31474d49
+#define BOOT_IMAGE_SHIFT 16
+
+typedef struct {
+  uint32_t magic, firmware;
+  cell_t base, used;  // used is in cells, followed by a bit per cell
+} BOOT_IMAGE_HEADER;
+
+static uint32_t boot_image_firmware(void) {
+  static const char built[] = __DATE__ __TIME__;
+  return name_hash(boot, sizeof(boot)) ^ name_hash(built, sizeof(built)) ^
+         (uint32_t) (ucell_t) forth_run ^ BUILTIN_COUNT;
+}
+
+static cell_t boot_image_checkpoint(cell_t *heap, cell_t size) {
+  memset(heap, 0, size);
+  forth_init(0, 0, heap, size, boot, sizeof(boot));
+  g_boot_checkpoint = 0;
+  while (!g_boot_checkpoint) {
+    g_sys->rp = forth_run(g_sys->rp);
+  }
+  return g_sys->heap - g_sys->heap_start;
+}
+
+// Free the segments a trial boot grew, before booting over it.
+static void boot_image_discard(void) {
+  g_sys->heap = g_sys->heap_start;
+  dict_release();
+}
+
+// Carry on from a checkpoint already in place at heap.
+static void boot_image_resume(cell_t *heap, cell_t size) {
+  g_sys = (G_SYS *) heap;
+  g_sys->heap_size = size;
+  g_sys->heap_limit = segment_limit(0);
+  forth_run(0);
+  dict_reset();
+}
+
+static int boot_image_load(cell_t *heap, cell_t size) {
+  BOOT_IMAGE_HEADER h;
+  uint8_t relocs[64];
+  int fd = open(BOOT_IMAGE_PATH, O_RDONLY);
+  if (fd < 0) { return 0; }
+  int ok = read(fd, &h, sizeof(h)) == sizeof(h) &&
+      h.magic == BOOT_IMAGE_MAGIC && h.firmware == boot_image_firmware() &&
+      h.used * (cell_t) sizeof(cell_t) <= size &&
+      read(fd, heap, h.used * sizeof(cell_t)) == h.used * (cell_t) sizeof(cell_t);
+  cell_t delta = (cell_t) heap - h.base;
+  for (cell_t i = 0; ok && i < h.used; i += sizeof(relocs) * 8) {
+    cell_t len = (h.used - i + 7) / 8;
+    if (len > (cell_t) sizeof(relocs)) { len = sizeof(relocs); }
+    ok = read(fd, relocs, len) == len;
+    for (cell_t j = 0; ok && j < len * 8 && i + j < h.used; ++j) {
+      if (relocs[j >> 3] & (1 << (j & 7))) { heap[i + j] += delta; }
+    }
+  }
+  close(fd);
+  if (!ok) { return -1; }
+  boot_image_resume(heap, size);
+  return 1;
+}
+
+static int boot_image_diff(int fd, const BOOT_IMAGE_HEADER *h,
+                           const cell_t *shifted, uint8_t *relocs) {
+  cell_t buf[64];
+  cell_t delta = BOOT_IMAGE_SHIFT * sizeof(cell_t);
+  if (lseek(fd, sizeof(*h), SEEK_SET) < 0) { return 0; }
+  for (cell_t i = 0; i < h->used; i += 64) {
+    cell_t len = h->used - i < 64 ? h->used - i : 64;
+    if (read(fd, buf, len * sizeof(cell_t)) != len * (cell_t) sizeof(cell_t)) {
+      return 0;
+    }
+    for (cell_t j = 0; j < len; ++j) {
+      if (shifted[i + j] == buf[j] + delta) {
+        relocs[(i + j) >> 3] |= 1 << ((i + j) & 7);
+      } else if (shifted[i + j] != buf[j]) {
+        return 0;
+      }
+    }
+  }
+  return 1;
+}
+
+static int boot_image_build(cell_t *heap, cell_t size) {
+  BOOT_IMAGE_HEADER h;
+  int fd = open(BOOT_IMAGE_PATH, O_RDWR | O_CREAT | O_TRUNC, 0666);
+  if (fd < 0) { return 0; }
+  cell_t full = size;
+  size -= BOOT_IMAGE_SHIFT * sizeof(cell_t);
+  h.magic = 0;
+  h.firmware = boot_image_firmware();
+  h.base = (cell_t) heap;
+  h.used = boot_image_checkpoint(heap, size);
+  cell_t bits = (h.used + 7) / 8;
+  // A boot that outgrew the heap given it spans segments: no image.
+  uint8_t *relocs = g_sys->segment ? 0 : (uint8_t *) calloc(bits, 1);
+  int ok = relocs && write(fd, &h, sizeof(h)) == sizeof(h) &&
+      write(fd, heap, h.used * sizeof(cell_t)) == h.used * (cell_t) sizeof(cell_t) &&
+      boot_image_checkpoint(heap + BOOT_IMAGE_SHIFT, size) == h.used &&
+      !g_sys->segment &&
+      boot_image_diff(fd, &h, heap + BOOT_IMAGE_SHIFT, relocs) &&
+      write(fd, relocs, bits) == bits;
+  h.magic = BOOT_IMAGE_MAGIC;
+  ok = ok && lseek(fd, 0, SEEK_SET) == 0 && write(fd, &h, sizeof(h)) == sizeof(h);
+  close(fd);
+  free(relocs);
+  if (!ok) { unlink(BOOT_IMAGE_PATH); }
+  // The second boot runs BOOT_IMAGE_SHIFT cells in, but the heap must
+  // start where malloc put it (relinquish reallocs it), so load the
+  // image just written, or failing that boot once more in place.
+  if ((cell_t *) g_sys != heap) {
+    boot_image_discard();
+    if (!ok || boot_image_load(heap, full) <= 0) { boot_image_checkpoint(heap, full); }
+  }
+  return 1;
+}
+
+static int boot_image_start(cell_t *heap, cell_t size) {
+#ifdef ENABLE_SPIFFS_SUPPORT
+  SPIFFS.begin(false, "/spiffs", 10);
+#endif
+  int status = boot_image_load(heap, size);
+  if (status < 0) { return boot_image_build(heap, size); }
+  return status;
+}
+#endif
+#ifdef ENABLE_XIP_SUPPORT
+// Execute-in-place dictionary.
+// A colon word is never written once ; has sized it, so those built by
+// boot-checkpoint are laid out in XIP_PARTITION and run from its
+// read-only mapping. Everything else is laid out after them, to be
+// copied into the heap on each boot. Both parts are relocated, with the
+// boot image fixups, for where they will run: the image only holds while
+// the mapping and the heap land where they did when it was built, and
+// with the firmware that built it, and is built again otherwise. Words
+// defined after the checkpoint stay in RAM.
+#define XIP_MAGIC 0x31504958
+#define XIP_SECTOR 4096
+#define XIP_HOST_SIZE (1 << 20)
+#define XIP_HEADROOM (32 * 1024)  // heap kept past the RAM part; it grows in segments
+
+typedef struct {
+  uint32_t magic, firmware;
+  cell_t flash_base, ram_base;  // where each part runs
+  cell_t flash_used, ram_used;  // bytes; the RAM part follows the words
+} XIP_HEADER;
+
+typedef struct {
+  cell_t from, to;  // bytes into the checkpoint
+  cell_t at;  // where they run from
+  cell_t skip;  // bytes frozen through to
+} XIP_RANGE;
+
+#ifdef ESP_PLATFORM
+static const esp_partition_t *g_xip_partition;
+
+static int xip_map(void) {
+  const void *map;
+  spi_flash_mmap_handle_t handle;
+  g_xip_partition = esp_partition_find_first(
+      ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, XIP_PARTITION);
+  if (!g_xip_partition ||
+      esp_partition_mmap(g_xip_partition, 0, g_xip_partition->size,
+                         SPI_FLASH_MMAP_DATA, &map, &handle) != ESP_OK) {
+    return 0;
+  }
+  g_xip.map = (const char *) map;
+  g_xip.size = g_xip_partition->size;
+  return 1;
+}
+
+static int xip_erase(cell_t at, cell_t len) {
+  return esp_partition_erase_range(g_xip_partition, at, len) == ESP_OK;
+}
+
+static int xip_write(cell_t at, const void *src, cell_t len) {
+  return esp_partition_write(g_xip_partition, at, src, len) == ESP_OK;
+}
+#else
+#include <sys/mman.h>
+
+static int g_xip_fd = -1;
+
+static int xip_map(void) {
+  struct stat st;
+  g_xip_fd = open(XIP_PARTITION, O_RDWR);
+  if (g_xip_fd < 0) { return 0; }
+  if (fstat(g_xip_fd, &st) < 0 ||
+      (st.st_size < XIP_HOST_SIZE && ftruncate(g_xip_fd, XIP_HOST_SIZE) < 0)) {
+    close(g_xip_fd);
+    return 0;
+  }
+  g_xip.size = st.st_size < XIP_HOST_SIZE ? XIP_HOST_SIZE : st.st_size & ~(XIP_SECTOR - 1);
+  void *map = mmap(0, g_xip.size, PROT_READ, MAP_SHARED, g_xip_fd, 0);
+  if (map == MAP_FAILED) { close(g_xip_fd); return 0; }
+  g_xip.map = (const char *) map;
+  return 1;
+}
+
+static int xip_erase(cell_t at, cell_t len) {
+  char erased[XIP_SECTOR];
+  memset(erased, 0xff, sizeof(erased));
+  for (; len > 0; at += XIP_SECTOR, len -= XIP_SECTOR) {
+    if (pwrite(g_xip_fd, erased, XIP_SECTOR, at) != XIP_SECTOR) { return 0; }
+  }
+  return 1;
+}
+
+static int xip_write(cell_t at, const void *src, cell_t len) {
+  return pwrite(g_xip_fd, src, len, at) == len;
+}
+#endif
+
+// The partition's header, if its image is for this firmware and will
+// load into size bytes at heap; 0 otherwise.
+static const XIP_HEADER *xip_header(cell_t *heap, cell_t size) {
+  const XIP_HEADER *h = (const XIP_HEADER *) g_xip.map;
+  if (h->magic != XIP_MAGIC || h->firmware != boot_image_firmware() ||
+      h->flash_base != (cell_t) g_xip.map || h->ram_base != (cell_t) heap ||
+      h->ram_used > size ||
+      (cell_t) sizeof(*h) + h->flash_used + h->ram_used > g_xip.size) {
+    return 0;
+  }
+  return h;
+}
+
+// Erase a header no image stands behind, so later boots build afresh.
+static void xip_invalidate(void) {
+  if (((const XIP_HEADER *) g_xip.map)->magic == XIP_MAGIC) {
+    xip_erase(0, XIP_SECTOR);
+  }
+}
+
+static int xip_load(cell_t *heap, cell_t size) {
+  const XIP_HEADER *h = xip_header(heap, size);
+  if (!h) { return 0; }
+  g_xip.words = g_xip.map + sizeof(*h);
+  g_xip.frozen = h->flash_used;
+  memcpy(heap, g_xip.words + g_xip.frozen, h->ram_used);
+  boot_image_resume(heap, size);
+  return 1;
+}
+
+// Colon words in every vocabulary, as bytes into the checkpoint at base.
+static cell_t xip_words(cell_t *base, cell_t used, XIP_RANGE *ranges) {
+  cell_t voc = FIND("internals");
+  cell_t last = voc ? find_wordlist((cell_t *) voc + 2, "last-vocabulary",
+                                    sizeof("last-vocabulary") - 1) : 0;
+  if (!last) { return 0; }
+  cell_t n = 0;
+  // A vocabulary (a DOES> word) has a body of: head, 0, next vocabulary.
+  cell_t v = ((cell_t *) last)[*(void **) last == g_sys->DOCREATE_OP ? 2 : 1];
+  for (; v; v = ((cell_t *) v)[4]) {
+    for (cell_t xt = ((cell_t *) v)[2]; xt && !dict_boundary(xt); xt = *TOLINK(xt)) {
+      if ((*TOFLAGS(xt) & (BUILTIN_MARK | SMUDGE)) ||
+          *(void **) xt != g_sys->DOCOL_OP ||
+          !*TOPARAMS(xt) || *TOPARAMS(xt) == 0xffff) { continue; }
+      cell_t from = (char *) TOLINK(xt) - CELL_ALIGNED(*TONAMELEN(xt)) - (char *) base;
+      cell_t to = (char *) ((cell_t *) xt + 1 + *TOPARAMS(xt)) - (char *) base;
+      if (from < (cell_t) sizeof(G_SYS) || to > used) { continue; }
+      if (ranges) { ranges[n].from = from; ranges[n].to = to; }
+      ++n;
+    }
+  }
+  return n;
+}
+
+static int xip_range_compare(const void *a, const void *b) {
+  cell_t x = ((const XIP_RANGE *) a)->from, y = ((const XIP_RANGE *) b)->from;
+  return x < y ? -1 : x > y ? 1 : 0;
+}
+
+// Where the cell d bytes into the checkpoint runs from.
+static cell_t xip_relocate(const XIP_RANGE *r, cell_t n, cell_t ram, cell_t d) {
+  cell_t lo = 0, hi = n;
+  while (lo < hi) {
+    cell_t mid = (lo + hi) / 2;
+    if (r[mid].from <= d) { lo = mid + 1; } else { hi = mid; }
+  }
+  if (!lo) { return ram + d; }
+  r += lo - 1;
+  return d < r->to ? r->at + d - r->from : ram + d - r->skip;
+}
+
+// Writes bytes from..to of the checkpoint at live, relocated, at *at.
+static int xip_emit(const cell_t *live, const uint8_t *relocs,
+                    const XIP_RANGE *r, cell_t n, cell_t ram,
+                    cell_t from, cell_t to, cell_t *at) {
+  cell_t buf[64];
+  for (cell_t i = from / sizeof(cell_t); i < to / (cell_t) sizeof(cell_t);) {
+    cell_t len = 0;
+    for (; len < 64 && i < to / (cell_t) sizeof(cell_t); ++len, ++i) {
+      buf[len] = live[i];
+      if (relocs[i >> 3] & (1 << (i & 7))) {
+        buf[len] = xip_relocate(r, n, ram, live[i] - (cell_t) live);
+      }
+    }
+    if (!xip_write(*at, buf, len * sizeof(cell_t))) { return 0; }
+    *at += len * sizeof(cell_t);
+  }
+  return 1;
+}
+
+// Boots twice as for a boot image, keeping the first in the end of the
+// partition to diff against, then writes the image and runs from it.
+static int xip_build(cell_t *heap, cell_t size) {
+  XIP_HEADER h;
+  cell_t *live = heap + BOOT_IMAGE_SHIFT;
+  cell_t bytes = boot_image_checkpoint(
+      heap, size - BOOT_IMAGE_SHIFT * sizeof(cell_t)) * sizeof(cell_t);
+  cell_t scratch = (g_xip.size - bytes) & ~(XIP_SECTOR - 1);
+  if (g_sys->segment || scratch < (cell_t) sizeof(h) + bytes) {
+    xip_invalidate();
+    return 1;
+  }
+  cell_t used = bytes / sizeof(cell_t);
+  uint8_t *relocs = (uint8_t *) calloc((used + 7) / 8, 1);
+  XIP_RANGE *r = 0;
+  cell_t n = 0;
+  int ok = relocs && xip_erase(scratch, g_xip.size - scratch) &&
+      xip_write(scratch, heap, bytes) &&
+      boot_image_checkpoint(live, size - BOOT_IMAGE_SHIFT * sizeof(cell_t)) == used &&
+      !g_sys->segment;
+  const cell_t *first = (const cell_t *) (g_xip.map + scratch);
+  cell_t delta = BOOT_IMAGE_SHIFT * sizeof(cell_t);
+  for (cell_t i = 0; ok && i < used; ++i) {
+    if (live[i] == first[i] + delta) {
+      relocs[i >> 3] |= 1 << (i & 7);
+    } else if (live[i] != first[i]) {
+      ok = 0;
+    }
+  }
+  if (ok) {
+    n = xip_words(live, bytes, 0);
+    r = (XIP_RANGE *) malloc((n + 1) * sizeof(XIP_RANGE));
+    ok = r && xip_words(live, bytes, r) == n;
+  }
+  if (ok) {
+    // Merge neighbours, then place them one after another.
+    qsort(r, n, sizeof(XIP_RANGE), xip_range_compare);
+    cell_t m = 0;
+    for (cell_t i = 0; i < n; ++i) {
+      if (m && r[i].from <= r[m - 1].to) {
+        if (r[i].to > r[m - 1].to) { r[m - 1].to = r[i].to; }
+      } else {
+        r[m++] = r[i];
+      }
+    }
+    n = m;
+    cell_t at = (cell_t) g_xip.map + sizeof(h), skip = 0;
+    for (cell_t i = 0; i < n; ++i) {
+      r[i].at = at;
+      skip += r[i].to - r[i].from;
+      r[i].skip = skip;
+      at += r[i].to - r[i].from;
+    }
+    h.magic = 0;
+    h.firmware = boot_image_firmware();
+    h.flash_base = (cell_t) g_xip.map;
+    h.ram_base = (cell_t) heap;
+    h.flash_used = skip;
+    h.ram_used = bytes - skip;
+    at = sizeof(h);
+    ok = xip_erase(0, scratch);
+    for (cell_t i = 0; ok && i < n; ++i) {
+      ok = xip_emit(live, relocs, r, n, (cell_t) heap, r[i].from, r[i].to, &at);
+    }
+    for (cell_t i = 0, from = 0; ok && i <= n; ++i) {
+      ok = xip_emit(live, relocs, r, n, (cell_t) heap,
+                    from, i < n ? r[i].from : bytes, &at);
+      if (i < n) { from = r[i].to; }
+    }
+    h.magic = XIP_MAGIC;
+    ok = ok && xip_write(0, &h, sizeof(h));
+  }
+  free(relocs);
+  free(r);
+  if (!ok) { xip_invalidate(); }
+  // As for a boot image, run from heap itself: from the image just
+  // written, or failing that from one more boot, in RAM.
+  if ((cell_t *) g_sys != heap) {
+    boot_image_discard();
+    if (!ok || !xip_load(heap, size)) { boot_image_checkpoint(heap, size); }
+  }
+  return 1;
+}
+
+static int xip_start(cell_t *heap, cell_t size) {
+  if (!xip_map()) { return 0; }
+  // setup took the largest block; an image that will load needs only its
+  // RAM part, so give the rest back. One that will not (after a firmware
+  // update, say) is built again, which needs the whole block. Shrinking
+  // leaves the block where it was, as ram_base requires; should it move,
+  // the image will not load and this boot runs from RAM.
+  const XIP_HEADER *h = xip_header(heap, size);
+  cell_t keep = h ? h->ram_used + XIP_HEADROOM : size;
+  if (keep < size) {
+    cell_t *kept = (cell_t *) realloc(heap, keep);
+    if (kept) { heap = kept; size = keep; }
+  }
+  return xip_load(heap, size) || xip_build(heap, size);
+}
+#endif
+
 void setup() {
   cell_t fh = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
   cell_t hc = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
   if (fh - hc < MINIMUM_FREE_SYSTEM_HEAP) {
     hc = fh - MINIMUM_FREE_SYSTEM_HEAP;
   }
+#ifdef DICTIONARY_START_SIZE
+  if (hc > DICTIONARY_START_SIZE) { hc = DICTIONARY_START_SIZE; }
+#endif
   cell_t *heap = (cell_t *) malloc(hc);
+  if (!heap_caps_get_free_size(MALLOC_CAP_SPIRAM)) { g_psram_threshold = 0; }
+#ifdef ENABLE_XIP_SUPPORT
+  if (xip_start(heap, hc)) { return; }
+#endif
+#ifdef ENABLE_BOOT_IMAGE_SUPPORT
+  if (boot_image_start(heap, hc)) { return; }
+#endif
   forth_init(0, 0, heap, hc, boot, sizeof(boot));
 }
 